@@ -0,0 +1,349 @@
+#include "stdafx.h"
+
+#include "CBenchApplication.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+
+#include "CCompare.h"
+#include "CDataSourceTextFile.h"
+
+#include "CChangeSetBuilder.h"
+#include "CChangeSetProcessor.h"
+
+
+typedef std::chrono::steady_clock CClock;
+
+
+// Milliseconds elapsed since inStart
+
+static double
+elapsedMs (CClock::time_point inStart)
+{
+	return std::chrono::duration<double, std::milli> (CClock::now () - inStart).count ();
+}
+
+
+// Quote string as JSON literal
+
+static std::string
+jsonString (const std::string &inStr)
+{
+	std::string result = "\"";
+
+	for (char c : inStr)
+	{
+		if (c == '"'  ||  c == '\\')
+		{
+			result += '\\';
+			result += c;
+		}
+		else if ((unsigned char) c < 0x20)
+		{
+			char buffer [8];
+			snprintf (buffer, sizeof (buffer), "\\u%04x", (unsigned) c);
+			result += buffer;
+		}
+		else
+		{
+			result += c;
+		}
+	}
+
+	return result + "\"";
+}
+
+
+// Temporary file filled with inText
+
+static FILE *
+makeTempFile (const std::string &inText)
+{
+	FILE *file = tmpfile ();
+	THROW_IF_NULL_WINFO (file, "tmpfile");
+
+	if (! inText.empty ())
+	{
+		THROW_IF (fwrite (inText.data (), 1, inText.size (), file) != inText.size (), XCantWrite);
+	}
+
+	rewind (file);
+
+	return file;
+}
+
+
+//
+//	class CBenchApplication
+//
+
+CBenchApplication::CBenchApplication (int argc, char *argv []) :
+	CApplication (argc, argv),
+	mCustom (false),
+	mIterations (5)
+{
+}
+
+
+CBenchApplication::~CBenchApplication ()
+{
+}
+
+
+void
+CBenchApplication::checkOption (const char *inOption)
+{
+	const char *value;
+
+	if ((value = getOptionValue (inOption, "/lines")) != NULL)
+	{
+		mParams.mLines = strtoul (value, NULL, 10);
+		mCustom = true;
+	}
+	else if ((value = getOptionValue (inOption, "/length")) != NULL)
+	{
+		mParams.mLineLength = strtoul (value, NULL, 10);
+		mCustom = true;
+	}
+	else if ((value = getOptionValue (inOption, "/density")) != NULL)
+	{
+		mParams.mEditDensity = strtod (value, NULL);
+		mCustom = true;
+	}
+	else if ((value = getOptionValue (inOption, "/cluster")) != NULL)
+	{
+		mParams.mClusterSize = strtoul (value, NULL, 10);
+		mCustom = true;
+	}
+	else if ((value = getOptionValue (inOption, "/dups")) != NULL)
+	{
+		mParams.mDuplicateRatio = strtod (value, NULL);
+		mCustom = true;
+	}
+	else if ((value = getOptionValue (inOption, "/seed")) != NULL)
+	{
+		mParams.mSeed = strtoull (value, NULL, 10);
+	}
+	else if ((value = getOptionValue (inOption, "/iterations")) != NULL)
+	{
+		mIterations = strtoul (value, NULL, 10);
+		THROW_IF (mIterations == 0, XIllegalUsage);
+	}
+	else if ((value = getOptionValue (inOption, "/label")) != NULL)
+	{
+		mLabel = value;
+	}
+	else THROW (XIllegalUsage);
+}
+
+
+void
+CBenchApplication::outputUsage ()
+{
+	std::cout << "Usage:" << std::endl <<
+		mArgv[0] << " [/lines:N] [/length:N] [/density:F] [/cluster:N] [/dups:F]" <<
+		" [/seed:N] [/iterations:N] [/label:text]" << std::endl << std::endl <<
+		"Without corpus options a fixed set of scenarios is run." << std::endl <<
+		"Results are written to stdout as JSON." << std::endl << std::endl;
+}
+
+
+void
+CBenchApplication::execute ()
+{
+	std::cout << "{" << std::endl <<
+		"  \"suite\": \"sccs-bench\"," << std::endl <<
+		"  \"schema\": 1," << std::endl <<
+		"  \"label\": " << jsonString (mLabel) << "," << std::endl <<
+		"  \"iterations\": " << mIterations << "," << std::endl <<
+		"  \"scenarios\": [" << std::endl;
+
+	if (mCustom)
+	{
+		runScenario ("custom", mParams, true);
+	}
+	else
+	{
+		CCorpusParams params = mParams;
+
+		params.mLines = 1000;
+		runScenario ("small", params, false);
+
+		params.mLines = 4000;
+		params.mEditDensity = 0.02;
+		runScenario ("sparse", params, false);
+
+		params = mParams;
+		params.mLines = 2000;
+		params.mEditDensity = 0.3;
+		runScenario ("dense", params, false);
+
+		params = mParams;
+		params.mLines = 2000;
+		params.mEditDensity = 0.1;
+		params.mClusterSize = 20;
+		runScenario ("clustered", params, false);
+
+		params = mParams;
+		params.mLines = 2000;
+		params.mDuplicateRatio = 0.6;
+		runScenario ("duplicates", params, true);
+	}
+
+	std::cout << "  ]" << std::endl << "}" << std::endl;
+}
+
+
+void
+CBenchApplication::runScenario (const std::string &inName, const CCorpusParams &inParams, bool inLast)
+{
+	std::string textA, textB;
+
+	CCorpusGenerator generator (inParams);
+	generator.generate (textA, textB);
+
+	FILE *fileA = makeTempFile (textA);
+	FILE *fileB = makeTempFile (textB);
+	FILE *fileSet = NULL;
+
+	CResult compareResult = { "compare" };
+	CResult buildResult = { "build" };
+	CResult applyResult = { "apply" };
+
+	size_t linesA = 0, linesB = 0, runs = 0;
+	long setBytes = 0;
+
+	try
+	{
+		for (size_t i = 0; i < mIterations; i++)
+		{
+			// Engine, including reading and hashing both files
+
+			rewind (fileA);
+			rewind (fileB);
+
+			CClock::time_point start = CClock::now ();
+
+			CDataSourceTextFile dataA (fileA);
+			CDataSourceTextFile dataB (fileB);
+
+			cmp::CCompare<CDataSourceTextFile> compare (&dataA, &dataB);
+			cmp::CEditScript seq;
+
+			compare.process (&seq);
+
+			compareResult.mTimes.push_back (elapsedMs (start));
+
+			linesA = dataA.getSize ();
+			linesB = dataB.getSize ();
+			runs = seq.size ();
+
+			// Builder: context detection and changeset output
+
+			if (fileSet != NULL)
+			{
+				fclose (fileSet);
+			}
+
+			fileSet = makeTempFile ("");
+
+			start = CClock::now ();
+
+			{
+				CChangeSetBuilder builder (fileSet, dataA, dataB);
+
+				builder.startConstruction ();
+
+				for (const cmp::CEditRun &run : seq)
+				{
+					builder.applyRun (run);
+				}
+
+				builder.endConstruction ();
+			}
+
+			buildResult.mTimes.push_back (elapsedMs (start));
+
+			fseek (fileSet, 0, SEEK_END);
+			setBytes = ftell (fileSet);
+
+			// Processor: apply changeset to the first file
+
+			rewind (fileA);
+			rewind (fileSet);
+
+			FILE *fileOut = makeTempFile ("");
+
+			start = CClock::now ();
+
+			{
+				CChangeSetProcessor processor (fileA, fileOut, fileSet);
+				processor.process ();
+			}
+
+			applyResult.mTimes.push_back (elapsedMs (start));
+
+			fclose (fileOut);
+		}
+	}
+	catch (...)
+	{
+		fclose (fileA);
+		fclose (fileB);
+
+		if (fileSet != NULL)
+		{
+			fclose (fileSet);
+		}
+
+		throw;
+	}
+
+	fclose (fileA);
+	fclose (fileB);
+	fclose (fileSet);
+
+	std::cout << "    {" << std::endl <<
+		"      \"name\": " << jsonString (inName) << "," << std::endl <<
+		"      \"corpus\": { \"lines\": " << inParams.mLines <<
+		", \"line_length\": " << inParams.mLineLength <<
+		", \"edit_density\": " << inParams.mEditDensity <<
+		", \"cluster_size\": " << inParams.mClusterSize <<
+		", \"duplicate_ratio\": " << inParams.mDuplicateRatio <<
+		", \"seed\": " << inParams.mSeed << " }," << std::endl <<
+		"      \"lines_a\": " << linesA << ", \"lines_b\": " << linesB <<
+		", \"bytes_a\": " << textA.size () << ", \"bytes_b\": " << textB.size () <<
+		", \"edit_runs\": " << runs << ", \"changeset_bytes\": " << setBytes << "," << std::endl <<
+		"      \"results\": [" << std::endl;
+
+	outputResult (compareResult, false);
+	outputResult (buildResult, false);
+	outputResult (applyResult, true);
+
+	std::cout << "      ]" << std::endl <<
+		"    }" << (inLast ? "" : ",") << std::endl;
+}
+
+
+void
+CBenchApplication::outputResult (const CResult &inResult, bool inLast)
+{
+	std::vector<double> times (inResult.mTimes);
+
+	std::sort (times.begin (), times.end ());
+
+	double mean = std::accumulate (times.begin (), times.end (), 0.0) / times.size ();
+
+	std::cout << std::fixed << std::setprecision (3) <<
+		"        { \"name\": " << jsonString (inResult.mName) <<
+		", \"min_ms\": " << times.front () <<
+		", \"median_ms\": " << times [times.size () / 2] <<
+		", \"mean_ms\": " << mean <<
+		", \"max_ms\": " << times.back () << " }" <<
+		(inLast ? "" : ",") << std::endl;
+
+	std::cout.unsetf (std::ios_base::floatfield);
+	std::cout << std::setprecision (6);
+}
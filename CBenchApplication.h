@@ -0,0 +1,59 @@
+#ifndef __CBenchApplication_h
+#define __CBenchApplication_h
+
+#include <string>
+#include <vector>
+
+#include "CApplication.h"
+#include "CCorpusGenerator.h"
+
+
+//
+//	class CBenchApplication
+//
+//	Microbenchmarks of the diff engine, changeset builder and processor
+//	over synthetic corpora, results go to stdout as JSON
+//
+
+class CBenchApplication : public CApplication
+{
+public:
+
+	CBenchApplication (int argc, char *argv []);
+
+	virtual ~CBenchApplication ();
+
+	// Configurate application via options
+	virtual void checkOption (const char *inOption);
+
+	// Output usage line
+	virtual void outputUsage ();
+
+	virtual void execute ();
+
+protected:
+
+	// Timings of one benchmark, milliseconds
+
+	struct CResult
+	{
+		std::string mName;
+		std::vector<double> mTimes;
+	};
+
+	// Run all benchmarks on a corpus, output JSON object for it
+
+	void runScenario (const std::string &inName, const CCorpusParams &inParams, bool inLast);
+
+	static void outputResult (const CResult &inResult, bool inLast);
+
+	CCorpusParams mParams;
+
+	bool mCustom;			// corpus knobs were given, run just that one
+	size_t mIterations;
+
+	std::string mLabel;		// version label to tag results with
+};
+
+
+#endif	// __CBenchApplication_h
@@ -0,0 +1,218 @@
+#include "stdafx.h"
+
+#include "CChangeSet.h"
+
+#include "CIntraline.h"
+#include "CStats.h"
+
+
+//
+//	class CChangeSet
+//
+
+CChangeSet::CChangeSet() :
+	mHasSource(false), mHasTarget(false)
+{
+}
+
+
+CChangeSet::~CChangeSet()
+{
+}
+
+
+// [BEGIN] starts the change set, and we don't care what happens after [END]
+
+void
+CChangeSet::read(CLineReader &inReader)
+{
+	STATS_PHASE(kPhaseParse);
+
+	mHunks.clear();
+
+	THROW_IF_WINFO(readCommandPart(inReader) != kBegin, XBadDiff, "No [BEGIN] at file start");
+
+	readHeader();
+
+	short cmd = readCommandPart(inReader);
+
+	while (cmd != kEnd)
+	{
+		mHunks.emplace_back();
+
+		CHunk &hunk = mHunks.back();
+
+		hunk.mCommand = cmd;
+		hunk.mLine = readPosition();
+
+		switch (cmd)
+		{
+		case kInsert:
+		case kDelete:
+
+			cmd = readCommandPart(inReader, &hunk.mWhat);
+			THROW_IF_NOT_WINFO(cmd == kBetween, XBadDiff, "[BETWEEN] expected");
+
+			cmd = readCommandPart(inReader, &hunk.mBefore);
+			THROW_IF_NOT_WINFO(cmd == kAnd, XBadDiff, "[AND] expected");
+
+			// Command stored for next iteration
+
+			cmd = readCommandPart(inReader, &hunk.mAfter);
+
+			break;
+
+		case kReplace:
+
+			cmd = readCommandPart(inReader, &hunk.mWhat);
+			THROW_IF_NOT_WINFO(cmd == kWith, XBadDiff, "[WITH] expected");
+
+			// Command stored for next iteration
+
+			cmd = readCommandPart(inReader, &hunk.mWith, &hunk.mWhat);
+
+			break;
+
+		default:
+
+			THROW_WINFO(XBadDiff, "[INSERT], [DELETE], [REPLACE] or [END] expected");
+		}
+	}
+}
+
+
+short
+CChangeSet::readCommandPart(CLineReader &inReader, std::vector<CHashedString> *outBuffer,
+	const std::vector<CHashedString> *inBase)
+{
+	if (outBuffer != NULL)
+	{
+		outBuffer->clear();
+	}
+
+	for (;;)
+	{
+		const char *line;
+		size_t len;
+
+		THROW_IF_NOT_WINFO(inReader.readLine(&line, &len), XBadDiff, "Expecting command part");
+
+		if (len > 0  &&  line[0] == '[')
+		{
+			// Fields may follow the command word
+
+			std::string str(line, len);
+
+			size_t pos = str.find_first_of(" \t");
+
+			if (pos != std::string::npos)
+			{
+				mFields.assign(str, pos + 1, std::string::npos);
+				str.erase(pos);
+			}
+			else
+			{
+				mFields.clear();
+			}
+
+			if (strcmp(str.c_str(), "[BEGIN]") == 0)	return kBegin;
+			else if (strcmp(str.c_str(), "[END]") == 0)	return kEnd;
+			else if (strcmp(str.c_str(), "[INSERT]") == 0)	return kInsert;
+			else if (strcmp(str.c_str(), "[REPLACE]") == 0)	return kReplace;
+			else if (strcmp(str.c_str(), "[DELETE]") == 0)	return kDelete;
+			else if (strcmp(str.c_str(), "[BETWEEN]") == 0)	return kBetween;
+			else if (strcmp(str.c_str(), "[AND]") == 0)	return kAnd;
+			else if (strcmp(str.c_str(), "[WITH]") == 0)	return kWith;
+
+			// Unrecognized reserved word
+
+			str.insert(0, "Unrecognized command: ");
+
+			THROW_WINFO(XBadDiff, str.c_str());
+		}
+		else if (len > 0  &&  line[0] == '~'  &&  outBuffer != NULL  &&  inBase != NULL)
+		{
+			// Edits of the base line at the same place, "~" alone copies it
+
+			size_t index = outBuffer->size();
+
+			THROW_IF_WINFO(index >= inBase->size(), XBadDiff, "Intraline edits without a base line");
+			THROW_IF_WINFO(len > 1  &&  line[1] != ' ', XBadDiff, "Non-command line without '~ ' prefix");
+
+			if (len > 2)
+			{
+				CIntraline::decode((*inBase)[index], line + 2, len - 2, mLine);
+				outBuffer->emplace_back(mLine.data(), mLine.size());
+			}
+			else
+			{
+				outBuffer->push_back((*inBase)[index]);
+			}
+		}
+		else
+		{
+			THROW_IF_NOT_WINFO(outBuffer, XBadDiff, "Command word expected");
+
+			// Every non-command line must have prefix "> "
+
+			THROW_IF_WINFO(len < 2  ||  strncmp(line, "> ", 2), XBadDiff,
+				"Non-command line without '> ' prefix");
+
+			// Remove prefix and add line to buffer, hashing the rest of it
+
+			outBuffer->emplace_back(line + 2, len - 2);
+		}
+	}
+}
+
+
+// [BEGIN] may carry "source=" and "target=" fingerprints, other fields are skipped
+
+void
+CChangeSet::readHeader()
+{
+	for (size_t begin = 0; begin < mFields.size(); )
+	{
+		size_t end = mFields.find_first_of(" \t", begin);
+
+		if (end == std::string::npos)
+		{
+			end = mFields.size();
+		}
+
+		const char *field = mFields.c_str() + begin;
+		size_t length = end - begin;
+
+		if (length > 7  &&  strncmp(field, "source=", 7) == 0)
+		{
+			mHasSource = mSource.parse(field + 7, length - 7);
+		}
+		else if (length > 7  &&  strncmp(field, "target=", 7) == 0)
+		{
+			mHasTarget = mTarget.parse(field + 7, length - 7);
+		}
+
+		begin = end + 1;
+	}
+}
+
+
+// "@N" field of a hunk command is the 1-based line its pattern starts at
+
+size_t
+CChangeSet::readPosition() const
+{
+	size_t at = mFields.find('@');
+
+	if (at == std::string::npos)
+	{
+		return -1;
+	}
+
+	const char *digits = mFields.c_str() + at + 1;
+	char *end;
+
+	unsigned long long line = strtoull(digits, &end, 10);
+
+	return (end != digits  &&  line > 0) ? (size_t) (line - 1) : (size_t) -1;
+}
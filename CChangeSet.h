@@ -0,0 +1,92 @@
+#ifndef __CChangeSet_h
+#define __CChangeSet_h
+
+#include <string>
+#include <vector>
+
+#include "CDataSourceTextFile.h"
+#include "CLineReader.h"
+
+DECLARE_EXCEPTION(XBadDiff, XRuntime, "Corrupted change set file");
+
+
+//
+//	class CChangeSet
+//
+//  Change set parsed at once. It is not changed after read(), so any number
+//	of processors may apply it at the same time
+//
+
+class CChangeSet
+{
+public:
+
+	enum
+	{
+		kNone = 0,
+		kBegin = 1,
+		kEnd = 2,
+		kInsert = 3,
+		kReplace = 4,
+		kDelete = 5,
+		kBetween = 6,
+		kAnd = 7,
+		kWith = 8
+	};
+
+	struct CHunk
+	{
+		short mCommand;		// kInsert, kDelete or kReplace
+		size_t mLine;		// 0-based line of the "@N" field, -1 if none
+
+		std::vector<CHashedString> mWhat;	// lines inserted, deleted or replaced
+		std::vector<CHashedString> mWith;	// replacing lines
+		std::vector<CHashedString> mBefore;	// context of an insert or delete
+		std::vector<CHashedString> mAfter;
+	};
+
+	CChangeSet();
+	virtual ~CChangeSet();
+
+	// Parse the whole change set, throws XBadDiff if it is corrupted
+
+	void read(CLineReader &inReader);
+
+	const std::vector<CHunk> &getHunks() const { return mHunks; }
+
+	// Fingerprints [BEGIN] carries, if any
+
+	bool hasSource() const { return mHasSource; }
+	bool hasTarget() const { return mHasTarget; }
+
+	const CFingerprint &getSource() const { return mSource; }
+	const CFingerprint &getTarget() const { return mTarget; }
+
+protected:
+
+	// prevent compiler autogeneration
+	CChangeSet(const CChangeSet &);
+	CChangeSet &operator=(const CChangeSet &);
+
+	// inBase holds the lines "~ " intraline edits of the part apply to
+
+	short readCommandPart(CLineReader &inReader, std::vector<CHashedString> *outBuffer = NULL,
+		const std::vector<CHashedString> *inBase = NULL);
+
+	// Fields of the [BEGIN] command and the line of a hunk command
+
+	void readHeader();
+	size_t readPosition() const;
+
+	std::vector<CHunk> mHunks;
+
+	CFingerprint mSource;
+	CFingerprint mTarget;
+	bool mHasSource;
+	bool mHasTarget;
+
+	std::string mFields;	// rest of the last command line
+	std::string mLine;		// intraline edits decode here
+};
+
+#endif	// __CChangeSet_h
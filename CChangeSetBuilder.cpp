@@ -1,333 +1,787 @@
-#include "stdafx.h"
-
-#include "CChangeSetBuilder.h"
-#include "CDataSourceTextFile.h"
-
-
-//
-//	class CChangeSetBuilder
-//
-//  Keeps functionality to build change set
-//
-
-CChangeSetBuilder::CChangeSetBuilder (
-	FILE *inOutFile,
-	CDataSourceTextFile &inSource,
-	CDataSourceTextFile &inDest) :
-
-	mOutFile (inOutFile), mSource (inSource), mDest (inDest)
-{
-	THROW_IF_NOT(mOutFile  &&  &mSource  &&  &mDest, XBadParameter);
-}
-
-
-CChangeSetBuilder::~CChangeSetBuilder ()
-{
-	mData.clear ();
-}
-
-
-void
-CChangeSetBuilder::insertLine (size_t inIndex)
-{
-	// Do not operate immediately, just store the change
-	mToInsert.extend (inIndex);
-}
-
-
-void
-CChangeSetBuilder::deleteLine (size_t inIndex)
-{
-	// Do not operate immediately, just store the change
-	mToDelete.extend (inIndex);
-}
-
-
-void
-CChangeSetBuilder::skipLine ()
-{
-	// Check if we have pending operations
-
-	pendingOps ();
-
-	mPosition ++;
-}
-
-
-// Output string to file with end of line
-
-void
-CChangeSetBuilder::outputString (const char *inStr, bool isCommand)
-{
-	THROW_IF (inStr == NULL, XBadParameter);
-	
-	if (! isCommand)
-	{
-		THROW_IF (fputs ("> ", mOutFile) == EOF, XCantWrite);
-	}
-
-	THROW_IF (fputs (inStr, mOutFile) == EOF, XCantWrite);
-	THROW_IF (fputc ('\n', mOutFile) == EOF, XCantWrite);
-}
-
-
-void
-CChangeSetBuilder::startConstruction ()
-{
-	mPosition = 0;
-
-	// Fill it with source content
-
-	for (size_t i = 0; i < mSource.getSize (); i++)
-	{
-		const CHashedString *data;
-		THROW_IF_NOT_W (mSource.getAt (i, &data), XUnknown);
-
-		mData.push_back (data);
-	}
-
-	outputString ("[BEGIN]", true);
-}
-
-
-void
-CChangeSetBuilder::endConstruction ()
-{
-	// Check if we have pending operations
-	
-	pendingOps ();
-
-	outputString ("[END]", true);
-}
-
-
-// Check pattern for unambiguety and uniqueness
-
-bool
-CChangeSetBuilder::isUnique (CRange &inRange)
-{
-	size_t dataSize = mData.size ();
-	size_t rangeSize = inRange.size ();
-
-	for (size_t i = 0; i <= dataSize - rangeSize; i++)
-	{
-		if (i == inRange.mL)
-		{
-			continue;
-		}
-		
-		size_t j;
-
-		for (j = 0; j < rangeSize  &&
-			mData [inRange.mL + j]->compare (* mData [i + j] ) == 0; j++)
-		{
-		}
-
-		if (j == rangeSize)
-		{
-			return false;		// matched!
-		}
-	}
-
-	return true;
-}
-
-
-// Detect minimum and unique (unambiguous in context of source)
-// pattern enclosing mPosition
-
-void
-CChangeSetBuilder::detectPattern (CRange &outRange)
-{
-	size_t dataSize = mData.size ();
-	
-	CRange initRange (outRange);
-
-	bool extRight = true;
-	
-	// Try to extend pattern range to the left/right by moving bound on 1
-	// until we found unique one
-	
-	while (! isUnique (outRange))
-	{
-		if ((extRight  ||  outRange.mL == 0)  &&  outRange.mR < dataSize)
-		{
-			outRange.mR ++;
-			extRight = false;
-		}
-		else if (outRange.mL > 0)
-		{
-			outRange.mL --;
-			extRight = true;
-		}
-		else THROW_WINFO (XRuntime, "detectPattern: bad flag flipping state");
-	}
-	
-	if (outRange.size () <= 2)
-	{
-		// Nothing to do anymore
-
-		return;
-	}
-
-	// Now we have unique pattern, then try to make it as small as possible
-	
-	CRange tmpRange (outRange);
-
-	do 
-	{
-		// Store result
-		
-		outRange = tmpRange;
-
-		// Which operation was the last?
-		
-		if (extRight)
-		{
-			// Last change happen on left bound, shrink it back
-			
-			tmpRange.mR --;
-		}
-		else
-		{
-			tmpRange.mL ++;
-		}
-	}
-	while (tmpRange.isEnclose (initRange)  &&  isUnique (tmpRange));
-}
-
-
-void
-CChangeSetBuilder::pendingOps ()
-{
-	CRange target;
-	const CHashedString *data;
-	size_t i;
-
-	if (mToInsert.isValid ())
-	{
-		if (mToDelete.isValid ())
-		{
-			// Replace
-
-			target.set (mPosition, mPosition + mToDelete.size ());
-			
-			detectPattern (target);
-			
-			outputString ("[REPLACE]", true);
-			
-			for (i = target.mL; i < target.mR; i++)
-			{
-				outputString (mData [i]->c_str ());
-			}
-		
-			mData.erase (mData.begin () + mPosition, 
-				mData.begin () + mPosition + mToDelete.size ());
-			
-			for (i = mToInsert.mL; i < mToInsert.mR; i++)
-			{
-				THROW_IF_NOT_W (mDest.getAt (i, &data), XUnknown);
-				
-				mData.insert (mData.begin () + mPosition, data);
-
-				mPosition ++;
-			}
-			
-			outputString ("[WITH]", true);
-
-			target.mR += mToInsert.size () - mToDelete.size ();
-
-			for (i = target.mL; i < target.mR; i++)
-			{
-				outputString (mData [i]->c_str ());
-			}
-		}
-		else
-		{
-			// Insert
-
-			target.mL = (mPosition > 0) ? mPosition - 1 : mPosition;
-			target.mR = (mPosition < mData.size ()) ? mPosition + 1 : mPosition;
-			
-			detectPattern (target);
-
-			outputString ("[INSERT]", true);
-			
-			// Note, that "before-after" is a single unique context
-
-			CRange before (target.mL, mPosition);
-			CRange after (mPosition, target.mR);
-				
-			for (i = mToInsert.mL; i < mToInsert.mR; i++)
-			{
-				THROW_IF_NOT_W (mDest.getAt (i, &data), XUnknown);
-				
-				outputString (data->c_str ());
-				mData.insert (mData.begin () + mPosition, data);
-
-				mPosition ++;
-			}
-			
-			after.shift (mToInsert.size ());
-			
-			outputString ("[BETWEEN]", true);
-			
-			for (i = before.mL; i < before.mR; i++)
-			{
-				outputString (mData [i]->c_str ());
-			}
-			
-			outputString ("[AND]", true);
-			
-			for (i = after.mL; i < after.mR; i++)
-			{
-				outputString (mData [i]->c_str ());
-			}
-		}
-	}
-	else if (mToDelete.isValid ())
-	{
-		// Delete
-		
-		target.mL = (mPosition > 0) ? mPosition - 1 : mPosition;
-		target.mR = mPosition + mToDelete.size ();
-		target.mR += (target.mR < mData.size ()) ? 1 : 0;
-		
-		detectPattern (target);
-		
-		outputString ("[DELETE]", true);
-		
-		// Note, that "before-delete-after" is a single unique context
-		// and delete is a legal part of it!
-		
-		CRange before (target.mL, mPosition);
-		CRange after (mPosition, target.mR - mToDelete.size ());
-		
-		for (i = mToDelete.mL; i < mToDelete.mR; i++)
-		{
-			THROW_IF_NOT_W (mSource.getAt (i, &data), XUnknown);
-			
-			outputString (data->c_str ());
-		}
-		
-		mData.erase (mData.begin () + mPosition, 
-			mData.begin () + mPosition + mToDelete.size ());
-		
-		outputString ("[BETWEEN]", true);
-		
-		for (i = before.mL; i < before.mR; i++)
-		{
-			outputString (mData [i]->c_str ());
-		}
-		
-		outputString ("[AND]", true);
-		
-		for (i = after.mL; i < after.mR; i++)
-		{
-			outputString (mData [i]->c_str ());
-		}
-	}
-	
-	mToDelete.clear ();
-	mToInsert.clear ();
-}
+#include "stdafx.h"
+
+#include "CChangeSetBuilder.h"
+#include "CDataSourceTextFile.h"
+#include "CStats.h"
+
+
+//
+//	class CChangeSetBuilder
+//
+//  Keeps functionality to build change set
+//
+
+CChangeSetBuilder::CChangeSetBuilder (
+	FILE *inOutFile,
+	CDataSourceTextFile &inSource,
+	CDataSourceTextFile &inDest) :
+
+	mOutFile (inOutFile), mWriter (inOutFile), mSource (inSource), mDest (inDest),
+	mSourceLines (NULL), mDestLines (NULL), mPosition (0), mSourcePosition (0),
+	mScriptSource (0), mScriptDest (0),
+	mHeld (false), mHeldDelete (0), mHeldInsert (0), mHeldCost (0), mGap (0),
+	mMaxMergeGap (kDefaultMaxMergeGap), mFingerprint (false), mIntraline (CIntraline::kModeNone)
+{
+	THROW_IF_NOT(mOutFile  &&  &mSource  &&  &mDest, XBadParameter);
+}
+
+
+CChangeSetBuilder::CChangeSetBuilder (
+	std::string *outChangeSet,
+	CDataSourceTextFile &inSource,
+	CDataSourceTextFile &inDest) :
+
+	mOutFile (NULL), mWriter (outChangeSet), mSource (inSource), mDest (inDest),
+	mSourceLines (NULL), mDestLines (NULL), mPosition (0), mSourcePosition (0),
+	mScriptSource (0), mScriptDest (0),
+	mHeld (false), mHeldDelete (0), mHeldInsert (0), mHeldCost (0), mGap (0),
+	mMaxMergeGap (kDefaultMaxMergeGap), mFingerprint (false), mIntraline (CIntraline::kModeNone)
+{
+}
+
+
+CChangeSetBuilder::~CChangeSetBuilder ()
+{
+}
+
+
+void
+CChangeSetBuilder::insertLine (size_t inIndex)
+{
+	// Do not operate immediately, just store the change
+	mToInsert.extend (inIndex);
+}
+
+
+void
+CChangeSetBuilder::deleteLine (size_t inIndex)
+{
+	// Do not operate immediately, just store the change
+	mToDelete.extend (inIndex);
+}
+
+
+void
+CChangeSetBuilder::skipLine ()
+{
+	keepLines (1);
+}
+
+
+void
+CChangeSetBuilder::applyRun (const cmp::CEditRun &inRun)
+{
+	switch (inRun.mType)
+	{
+	case cmp::kRemove:
+
+		mToDelete.extend (inRun.mStart, inRun.mLength);
+		break;
+
+	case cmp::kInsert:
+
+		mToInsert.extend (inRun.mStart, inRun.mLength);
+		break;
+
+	case cmp::kKeep:
+
+		keepLines (inRun.mLength);
+		break;
+
+	default:
+
+		THROW_WINFO (XBadParameter, "applyRun: undefined run type");
+	}
+}
+
+
+// Output string to file with end of line
+
+void
+CChangeSetBuilder::outputString (const char *inStr, bool isCommand)
+{
+	THROW_IF (inStr == NULL, XBadParameter);
+	
+	if (! isCommand)
+	{
+		mWriter.write ("> ", 2);
+	}
+
+	mWriter.write (inStr, strlen (inStr));
+	mWriter.write ('\n');
+}
+
+
+// Output data line, its text lives in the data sources till the end,
+// so it is referenced rather than copied
+
+void
+CChangeSetBuilder::outputString (const CHashedString &inStr)
+{
+	mWriter.write ("> ", 2);
+	mWriter.writeRef (inStr);
+	mWriter.write ('\n');
+}
+
+
+void
+CChangeSetBuilder::outputReplacement (const CHashedString &inStr, const CHashedString *inBase)
+{
+	if (inBase != NULL)
+	{
+		// Text compare, lines equal under a whitespace mode may still differ
+
+		if (inStr.size () == inBase->size ()  &&  memcmp (inStr.data (), inBase->data (), inStr.size ()) == 0)
+		{
+			mWriter.write ("~\n", 2);
+			return;
+		}
+
+		if (CIntraline::encode (*inBase, inStr, mIntraline, mEdits))
+		{
+			mWriter.write ("~ ", 2);
+			mWriter.write (mEdits.data (), mEdits.size ());
+			mWriter.write ('\n');
+			return;
+		}
+	}
+
+	outputString (inStr);
+}
+
+
+void
+CChangeSetBuilder::startConstruction ()
+{
+	mPosition = 0;
+	mSourcePosition = 0;
+
+	mHeld = false;
+	mGap = 0;
+
+	mSourceLines = mSource.getData ();
+	mDestLines = mDest.getData ();
+
+	mScriptSource = 0;
+	mScriptDest = 0;
+	mKeptSource.assign ((mSource.getNormalization () != CHashedString::kNormalizeNone) ? mDest.getSize () : 0,
+		(size_t) -1);
+
+	// Index both sources, positions come in ascending order
+
+	mSourceIndex.clear ();
+	mDestIndex.clear ();
+
+	for (size_t i = 0; i < mSource.getSize (); i++)
+	{
+		mSourceIndex [mSourceLines [i].getHashValue ()].push_back (i);
+	}
+
+	for (size_t i = 0; i < mDest.getSize (); i++)
+	{
+		mDestIndex [mDestLines [i].getHashValue ()].push_back (i);
+	}
+
+	if (! mFingerprint)
+	{
+		outputString ("[BEGIN]", true);
+		return;
+	}
+
+	CFingerprint source, target;
+
+	for (size_t i = 0; i < mSource.getSize (); i++)
+	{
+		source.addLine (mSourceLines [i].data (), mSourceLines [i].size ());
+	}
+
+	for (size_t i = 0; i < mDest.getSize (); i++)
+	{
+		target.addLine (mDestLines [i].data (), mDestLines [i].size ());
+	}
+
+	std::string header ("[BEGIN] source=");
+
+	header += source.toString ();
+
+	// Lines equal under a whitespace mode keep the source text when applied,
+	// the result is not the target then
+
+	if (mSource.getNormalization () == CHashedString::kNormalizeNone)
+	{
+		header += " target=";
+		header += target.toString ();
+	}
+
+	outputString (header.c_str (), true);
+}
+
+
+void
+CChangeSetBuilder::endConstruction ()
+{
+	// Check if we have pending operations
+	
+	pendingOps ();
+
+	outputString ("[END]", true);
+
+	mWriter.finish ();
+}
+
+
+// Check pattern for unambiguety and uniqueness. Any other occurrence holds the
+// rarest line of the pattern at the same offset, so only its positions are tried
+
+bool
+CChangeSetBuilder::isUnique (CRange &inRange)
+{
+	STATS_COUNT (kUniqueChecks, 1);
+
+	size_t dataSize = getLineCount ();
+	size_t rangeSize = inRange.size ();
+
+	const std::vector<size_t> *sourceHits = NULL;
+	const std::vector<size_t> *destHits = NULL;
+	size_t offset = 0;
+	size_t best = (size_t) -1;
+
+	for (size_t j = 0; j < rangeSize; j++)
+	{
+		uint64_t hash = getLine (inRange.mL + j).getHashValue ();
+
+		CLineIndex::const_iterator source = mSourceIndex.find (hash);
+		CLineIndex::const_iterator dest = mDestIndex.find (hash);
+
+		size_t count = ((source != mSourceIndex.end ()) ? source->second.size () : 0) +
+			((dest != mDestIndex.end ()) ? dest->second.size () : 0);
+
+		if (count < best)
+		{
+			best = count;
+			offset = j;
+			sourceHits = (source != mSourceIndex.end ()) ? &source->second : NULL;
+			destHits = (dest != mDestIndex.end ()) ? &dest->second : NULL;
+		}
+	}
+
+	auto matchesAt = [&] (size_t inLine) -> bool
+	{
+		if (inLine < offset  ||  inLine - offset == inRange.mL  ||  inLine - offset + rangeSize > dataSize)
+		{
+			return false;
+		}
+
+		size_t i = inLine - offset;
+		size_t j;
+
+		for (j = 0; j < rangeSize  &&
+			getLine (inRange.mL + j).compare (getLine (i + j)) == 0; j++)
+		{
+		}
+
+		return j == rangeSize;
+	};
+
+	if (destHits != NULL)
+	{
+		for (size_t line : *destHits)
+		{
+			if (line >= mPosition)
+			{
+				break;
+			}
+
+			if (matchesAt (line))
+			{
+				return false;		// matched!
+			}
+		}
+	}
+
+	if (sourceHits != NULL)
+	{
+		std::vector<size_t>::const_iterator it =
+			std::lower_bound (sourceHits->begin (), sourceHits->end (), mSourcePosition);
+
+		for (; it != sourceHits->end (); ++it)
+		{
+			if (matchesAt (mPosition + *it - mSourcePosition))
+			{
+				return false;		// matched!
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// Detect minimum and unique (unambiguous in context of source)
+// pattern enclosing mPosition
+
+void
+CChangeSetBuilder::detectPattern (CRange &outRange)
+{
+	STATS_PHASE (kPhaseContext);
+
+	size_t dataSize = getLineCount ();
+	
+	CRange initRange (outRange);
+
+	bool extRight = true;
+	
+	// Try to extend pattern range to the left/right by moving bound on 1
+	// until we found unique one
+	
+	while (! isUnique (outRange))
+	{
+		if ((extRight  ||  outRange.mL == 0)  &&  outRange.mR < dataSize)
+		{
+			outRange.mR ++;
+			extRight = false;
+		}
+		else if (outRange.mL > 0)
+		{
+			outRange.mL --;
+			extRight = true;
+		}
+		else THROW_WINFO (XRuntime, "detectPattern: bad flag flipping state");
+	}
+	
+	if (outRange.size () <= 2)
+	{
+		// Nothing to do anymore
+
+		return;
+	}
+
+	// Now we have unique pattern, then try to make it as small as possible
+	
+	CRange tmpRange (outRange);
+
+	do 
+	{
+		// Store result
+		
+		outRange = tmpRange;
+
+		// Which operation was the last?
+		
+		if (extRight)
+		{
+			// Last change happen on left bound, shrink it back
+			
+			tmpRange.mR --;
+		}
+		else
+		{
+			tmpRange.mL ++;
+		}
+	}
+	while (tmpRange.isEnclose (initRange)  &&  isUnique (tmpRange));
+}
+
+
+void
+CChangeSetBuilder::locateHunk (size_t inDelete, size_t inInsert, CRange &outTarget, const CRange *inUnique)
+{
+	if (inInsert > 0  &&  inDelete > 0)
+	{
+		outTarget.set (mPosition, mPosition + inDelete);
+	}
+	else if (inInsert > 0)
+	{
+		outTarget.mL = (mPosition > 0) ? mPosition - 1 : mPosition;
+		outTarget.mR = (mPosition < getLineCount ()) ? mPosition + 1 : mPosition;
+	}
+	else
+	{
+		outTarget.mL = (mPosition > 0) ? mPosition - 1 : mPosition;
+		outTarget.mR = mPosition + inDelete;
+		outTarget.mR += (outTarget.mR < getLineCount ()) ? 1 : 0;
+	}
+
+	if (inUnique != NULL)
+	{
+		shrinkPattern (*inUnique, outTarget);
+	}
+	else
+	{
+		detectPattern (outTarget);
+	}
+}
+
+
+// Any range enclosing a unique one is unique too, so there is only shrinking
+// to do, the left bound first
+
+void
+CChangeSetBuilder::shrinkPattern (const CRange &inUnique, CRange &ioRange)
+{
+	STATS_PHASE (kPhaseContext);
+
+	CRange range (std::min (inUnique.mL, ioRange.mL), std::max (inUnique.mR, ioRange.mR));
+
+	while (range.mL < ioRange.mL)
+	{
+		CRange tmpRange (range.mL + 1, range.mR);
+
+		if (! isUnique (tmpRange))
+		{
+			break;
+		}
+
+		range = tmpRange;
+	}
+
+	while (range.mR > ioRange.mR)
+	{
+		CRange tmpRange (range.mL, range.mR - 1);
+
+		if (! isUnique (tmpRange))
+		{
+			break;
+		}
+
+		range = tmpRange;
+	}
+
+	ioRange = range;
+}
+
+
+// Changeset bytes the hunk takes, every line is written with "> " and '\n'.
+// Replacing lines equal to the replaced ones are cheap with intraline edits
+
+size_t
+CChangeSetBuilder::getHunkCost (size_t inDelete, size_t inInsert, const CRange &inTarget)
+{
+	size_t i;
+
+	size_t cost = 0;
+
+	for (i = inTarget.mL; i < inTarget.mR; i++)
+	{
+		cost += getLine (i).size () + 3;
+	}
+
+	if (inInsert > 0  &&  inDelete > 0)
+	{
+		cost += sizeof ("[REPLACE]") + sizeof ("[WITH]");
+
+		size_t position = mPosition;
+		size_t sourcePosition = mSourcePosition;
+
+		std::vector<const CHashedString *> replaced;
+
+		for (i = inTarget.mL; i < inTarget.mR; i++)
+		{
+			replaced.push_back (&getLine (i));
+		}
+
+		mPosition += inInsert;
+		mSourcePosition += inDelete;
+
+		for (i = inTarget.mL; i < inTarget.mR + inInsert - inDelete; i++)
+		{
+			const CHashedString &line = getLine (i);
+			const CHashedString *base = (i - inTarget.mL < replaced.size ()) ? replaced [i - inTarget.mL] : NULL;
+
+			if (mIntraline != CIntraline::kModeNone  &&  base != NULL  &&
+				line.size () == base->size ()  &&  memcmp (line.data (), base->data (), line.size ()) == 0)
+			{
+				cost += 2;
+			}
+			else
+			{
+				cost += line.size () + 3;
+			}
+		}
+
+		mPosition = position;
+		mSourcePosition = sourcePosition;
+	}
+	else
+	{
+		cost += sizeof ("[INSERT]") + sizeof ("[BETWEEN]") + sizeof ("[AND]");
+
+		for (i = mPosition; i < mPosition + inInsert; i++)
+		{
+			cost += mDestLines [i].size () + 3;
+		}
+	}
+
+	return cost;
+}
+
+
+void
+CChangeSetBuilder::outputHunk (size_t inDelete, size_t inInsert, const CRange &inTarget)
+{
+	CRange target (inTarget);
+	size_t i;
+
+	if (inInsert > 0  &&  inDelete > 0)
+	{
+		// Replace
+
+		outputCommand ("[REPLACE]", target);
+
+		for (i = target.mL; i < target.mR; i++)
+		{
+			outputString (getLine (i));
+		}
+
+		// Bases of the intraline edits
+
+		std::vector<const CHashedString *> replaced;
+
+		if (mIntraline != CIntraline::kModeNone)
+		{
+			for (i = target.mL; i < target.mR; i++)
+			{
+				replaced.push_back (&getLine (i));
+			}
+		}
+
+		mPosition += inInsert;
+		mSourcePosition += inDelete;
+
+		outputString ("[WITH]", true);
+
+		target.mR += inInsert - inDelete;
+
+		for (i = target.mL; i < target.mR; i++)
+		{
+			outputReplacement (getLine (i),
+				(i - target.mL < replaced.size ()) ? replaced [i - target.mL] : NULL);
+		}
+	}
+	else if (inInsert > 0)
+	{
+		// Insert
+
+		outputCommand ("[INSERT]", target);
+
+		// Note, that "before-after" is a single unique context
+
+		CRange before (target.mL, mPosition);
+		CRange after (mPosition, target.mR);
+
+		for (i = mPosition; i < mPosition + inInsert; i++)
+		{
+			outputString (mDestLines [i]);
+		}
+
+		mPosition += inInsert;
+
+		after.shift (inInsert);
+
+		outputString ("[BETWEEN]", true);
+
+		for (i = before.mL; i < before.mR; i++)
+		{
+			outputString (getLine (i));
+		}
+
+		outputString ("[AND]", true);
+
+		for (i = after.mL; i < after.mR; i++)
+		{
+			outputString (getLine (i));
+		}
+	}
+	else if (inDelete > 0)
+	{
+		// Delete
+
+		outputCommand ("[DELETE]", target);
+
+		// Note, that "before-delete-after" is a single unique context
+		// and delete is a legal part of it!
+
+		CRange before (target.mL, mPosition);
+		CRange after (mPosition, target.mR - inDelete);
+
+		for (i = mSourcePosition; i < mSourcePosition + inDelete; i++)
+		{
+			outputString (mSourceLines [i]);
+		}
+
+		mSourcePosition += inDelete;
+
+		outputString ("[BETWEEN]", true);
+
+		for (i = before.mL; i < before.mR; i++)
+		{
+			outputString (getLine (i));
+		}
+
+		outputString ("[AND]", true);
+
+		for (i = after.mL; i < after.mR; i++)
+		{
+			outputString (getLine (i));
+		}
+	}
+}
+
+
+void
+CChangeSetBuilder::outputCommand (const char *inCommand, const CRange &inTarget)
+{
+	if (! mFingerprint)
+	{
+		outputString (inCommand, true);
+		return;
+	}
+
+	// 1-based line of the text being patched
+
+	char command [64];
+
+	snprintf (command, sizeof (command), "%s @%llu", inCommand, (unsigned long long) inTarget.mL + 1);
+
+	outputString (command, true);
+}
+
+
+void
+CChangeSetBuilder::outputHeld ()
+{
+	if (mHeld)
+	{
+		if (mHeldCost == (size_t) -1)
+		{
+			locateHunk (mHeldDelete, mHeldInsert, mHeldTarget);
+		}
+
+		outputHunk (mHeldDelete, mHeldInsert, mHeldTarget);
+
+		mPosition += mGap;
+		mSourcePosition += mGap;
+
+		mHeld = false;
+		mGap = 0;
+	}
+}
+
+
+// Edits collected since the last kept line end here. They are merged into
+// the held hunk if that does not take more changeset bytes than writing both,
+// the hunk is held while the following kept lines may still let it merge
+
+void
+CChangeSetBuilder::keepLines (size_t inCount)
+{
+	size_t toDelete = mToDelete.isValid () ? mToDelete.size () : 0;
+	size_t toInsert = mToInsert.isValid () ? mToInsert.size () : 0;
+
+	// Kept lines follow the edits in both texts
+
+	mScriptSource = (toDelete > 0) ? mToDelete.mR : mScriptSource;
+	mScriptDest = (toInsert > 0) ? mToInsert.mR : mScriptDest;
+
+	if (! mKeptSource.empty ())
+	{
+		for (size_t i = 0; i < inCount; i++)
+		{
+			mKeptSource [mScriptDest + i] = mScriptSource + i;
+		}
+	}
+
+	mScriptSource += inCount;
+	mScriptDest += inCount;
+
+	mToDelete.clear ();
+	mToInsert.clear ();
+
+	if (toDelete + toInsert > 0)
+	{
+		if (mHeld)
+		{
+			if (mHeldCost == (size_t) -1)
+			{
+				locateHunk (mHeldDelete, mHeldInsert, mHeldTarget);
+				mHeldCost = getHunkCost (mHeldDelete, mHeldInsert, mHeldTarget);
+			}
+
+			// The new hunk alone goes after the held one and the gap, where it
+			// is written if they are not merged
+
+			CRange target;
+
+			mPosition += mHeldInsert + mGap;
+			mSourcePosition += mHeldDelete + mGap;
+
+			locateHunk (toDelete, toInsert, target);
+			size_t cost = getHunkCost (toDelete, toInsert, target);
+
+			mPosition -= mHeldInsert + mGap;
+			mSourcePosition -= mHeldDelete + mGap;
+
+			// Both contexts together enclose the merged hunk and are unique,
+			// the one of the new hunk is shifted back past the held edits
+
+			size_t mergedDelete = mHeldDelete + mGap + toDelete;
+			size_t mergedInsert = mHeldInsert + mGap + toInsert;
+
+			CRange unique (mHeldTarget.mL, std::max (mHeldTarget.mR, target.mR + mHeldDelete - mHeldInsert));
+			CRange mergedTarget;
+
+			locateHunk (mergedDelete, mergedInsert, mergedTarget, &unique);
+			size_t mergedCost = getHunkCost (mergedDelete, mergedInsert, mergedTarget);
+
+			if (mergedCost <= mHeldCost + cost)
+			{
+				mHeldDelete = mergedDelete;
+				mHeldInsert = mergedInsert;
+				mHeldCost = mergedCost;
+				mHeldTarget = mergedTarget;
+				mGap = 0;
+			}
+			else
+			{
+				outputHeld ();
+
+				mHeld = true;
+				mHeldDelete = toDelete;
+				mHeldInsert = toInsert;
+				mHeldCost = cost;
+				mHeldTarget = target;
+			}
+		}
+		else
+		{
+			mHeld = true;
+			mHeldDelete = toDelete;
+			mHeldInsert = toInsert;
+			mHeldCost = (size_t) -1;
+		}
+	}
+
+	if (mHeld)
+	{
+		mGap += inCount;
+
+		if (mGap > mMaxMergeGap)
+		{
+			outputHeld ();
+		}
+	}
+	else
+	{
+		mPosition += inCount;
+		mSourcePosition += inCount;
+	}
+}
+
+
+void
+CChangeSetBuilder::pendingOps ()
+{
+	keepLines (0);
+
+	outputHeld ();
+}
@@ -1,112 +1,245 @@
-#ifndef __CChangeSetBuilder_h
-#define __CChangeSetBuilder_h
-
-#include <vector>
-
-#include "CCompare.h"
-#include "CDataSourceTextFile.h"
-
-//
-//	class CRange
-//
-//	Basic helper class, no virtual functions, no desctructor.
-//
-
-class CRange
-{
-public:
-
-	CRange () : mL (0), mR (0) { }
-	CRange (size_t from, size_t to) : mL (from), mR(to) { }
-	CRange (const CRange &range) : mL (range.mL), mR (range.mR) { }
-
-	inline void clear ()  { mL = mR = 0; }
-	
-	inline void set (size_t left, size_t right) { mL = left; mR = right; }
-
-	inline bool isValid ()  { return (mL < mR); }
-
-	inline size_t size () { return mR - mL; }
-
-	inline bool isEnclose (const CRange &inRange) 
-		{ return (mL <= inRange.mL  &&  mR >= inRange.mR);  }
-			
-	inline void shift (int offset) { mL += offset; mR += offset; }
-	
-	void extend (size_t inIndex)
-	{
-		// range naturally could be extended just by single line
-
-		if (isValid ())
-		{
-			THROW_IF_NOT (mR == inIndex, XOutOfRangeIndex);
-			mR ++; 
-		}
-		else
-		{
-			mL = inIndex;
-			mR = inIndex + 1;
-		}
-	}
-
-public:
-
-	size_t mL, mR;
-};
-
-
-//
-//	class CChangeSetBuilder
-//
-//  Keeps functionality to build change set
-//
-
-class CChangeSetBuilder
-{
-public:
-
-	CChangeSetBuilder (
-		FILE *inOutFile,
-		CDataSourceTextFile &inSource,
-		CDataSourceTextFile &inDest);
-	
-	virtual ~CChangeSetBuilder ();
-	
-	// Productive methods
-
-	void insertLine (size_t inIndex);
-	void deleteLine (size_t inIndex);
-	void skipLine ();
-	
-	void outputString (const char *inStr, bool isCommand = false);
-	
-	void startConstruction ();
-	void endConstruction ();
-	
-	// Check pattern for unambiguety and uniqueness
-
-	bool isUnique (CRange &inRange);
-	
-	// Detect minimum and unique (unambiguous in context of source)
-	// pattern enclosing mPosition
-
-	void detectPattern (CRange &outRange);
-	
-	void pendingOps ();
-
-protected:
-
-	FILE *mOutFile;
-    
-	std::vector<const CHashedString *>  mData;
-	
-	CDataSourceTextFile &mSource;
-	CDataSourceTextFile &mDest;
-	
-	size_t mPosition;
-
-	CRange mToInsert;
-	CRange mToDelete;
-};
-
-#endif	// __CChangeSetBuilder_h
+#ifndef __CChangeSetBuilder_h
+#define __CChangeSetBuilder_h
+
+#include <unordered_map>
+#include <vector>
+
+#include "CCompare.h"
+#include "CDataSourceTextFile.h"
+#include "CIntraline.h"
+#include "COutputWriter.h"
+
+//
+//	class CRange
+//
+//	Basic helper class, no virtual functions, no desctructor.
+//
+
+class CRange
+{
+public:
+
+	CRange () : mL (0), mR (0) { }
+	CRange (size_t from, size_t to) : mL (from), mR(to) { }
+	CRange (const CRange &range) : mL (range.mL), mR (range.mR) { }
+
+	inline void clear ()  { mL = mR = 0; }
+	
+	inline void set (size_t left, size_t right) { mL = left; mR = right; }
+
+	inline bool isValid ()  { return (mL < mR); }
+
+	inline size_t size () { return mR - mL; }
+
+	inline bool isEnclose (const CRange &inRange) 
+		{ return (mL <= inRange.mL  &&  mR >= inRange.mR);  }
+			
+	inline void shift (int offset) { mL += offset; mR += offset; }
+	
+	void extend (size_t inIndex, size_t inCount = 1)
+	{
+		// range naturally could be extended just by adjacent lines
+
+		if (isValid ())
+		{
+			THROW_IF_NOT (mR == inIndex, XOutOfRangeIndex);
+			mR += inCount; 
+		}
+		else
+		{
+			mL = inIndex;
+			mR = inIndex + inCount;
+		}
+	}
+
+public:
+
+	size_t mL, mR;
+};
+
+
+//
+//	class CChangeSetBuilder
+//
+//  Keeps functionality to build change set
+//
+//	The text being patched is never materialised: replaying the edit script,
+//	lines in front of the current position are the ones of the destination
+//	and the rest are the source ones past the consumed part. Contexts are
+//	checked for uniqueness by an index of line hashes of both sources.
+//
+//	A hunk followed by few kept lines is held back, the next one is merged
+//	into it with the kept lines in between whenever the merged hunk is not
+//	bigger than both of them apart. Contexts found while costing hunks are
+//	kept for writing them, the one of a merged hunk is shrunk from those of
+//	its parts
+//
+
+class CChangeSetBuilder
+{
+public:
+
+	CChangeSetBuilder (
+		FILE *inOutFile,
+		CDataSourceTextFile &inSource,
+		CDataSourceTextFile &inDest);
+
+	// Changeset is appended to the string
+
+	CChangeSetBuilder (
+		std::string *outChangeSet,
+		CDataSourceTextFile &inSource,
+		CDataSourceTextFile &inDest);
+	
+	virtual ~CChangeSetBuilder ();
+
+	// Write [WITH] lines as edits of the [REPLACE] lines at the same
+	// place when that is shorter, kModeNone (default) writes them whole
+
+	void setIntraline (CIntraline::EMode inMode) { mIntraline = inMode; }
+
+	// Write the changeset compressed (see CFrameCodec), call before
+	// startConstruction ()
+
+	void setCompression (bool inCompress) { mWriter.setCompression (inCompress); }
+
+	// Write fingerprints of both texts to [BEGIN] and the line every hunk is
+	// found at to its command, so that apply to the very source text needs no
+	// searching and checks its result
+
+	void setFingerprint (bool inFingerprint) { mFingerprint = inFingerprint; }
+
+	// Kept lines merging hunks around them at most, 0 never merges
+
+	void setMaxMergeGap (size_t inLines) { mMaxMergeGap = inLines; }
+	
+	// Productive methods
+
+	void insertLine (size_t inIndex);
+	void deleteLine (size_t inIndex);
+	void skipLine ();
+
+	// Consume whole run of the edit script at once
+
+	void applyRun (const cmp::CEditRun &inRun);
+	
+	void outputString (const char *inStr, bool isCommand = false);
+	void outputString (const CHashedString &inStr);
+
+	// Output [WITH] line, inBase is the [REPLACE] line at its place if any
+
+	void outputReplacement (const CHashedString &inStr, const CHashedString *inBase);
+	
+	void startConstruction ();
+	void endConstruction ();
+	
+	// Check pattern for unambiguety and uniqueness
+
+	bool isUnique (CRange &inRange);
+	
+	// Detect minimum and unique (unambiguous in context of source)
+	// pattern enclosing mPosition
+
+	void detectPattern (CRange &outRange);
+
+	// Output all the hunks held or being collected
+	
+	void pendingOps ();
+
+	static const size_t kDefaultMaxMergeGap = 8;
+
+protected:
+
+	// prevent compiler autogeneration
+	CChangeSetBuilder ();
+	CChangeSetBuilder (const CChangeSetBuilder &);
+	CChangeSetBuilder &operator= (const CChangeSetBuilder &);
+
+	// Line of the text being patched. Kept lines stay as the source has them
+	// when applied, they differ from the destination under a whitespace mode
+
+	const CHashedString &getLine (size_t inIndex) const
+	{
+		if (inIndex < mPosition)
+		{
+			size_t kept = mKeptSource.empty () ? (size_t) -1 : mKeptSource [inIndex];
+
+			return (kept != (size_t) -1) ? mSourceLines [kept] : mDestLines [inIndex];
+		}
+
+		return mSourceLines [inIndex - mPosition + mSourcePosition];
+	}
+
+	size_t getLineCount () const { return mPosition + mSource.getSize () - mSourcePosition; }
+
+	// Lines of the hunk removing inDelete lines and inserting inInsert ones at
+	// the current position, along with their unique context. inUnique is a
+	// unique range known to enclose them, if any
+
+	void locateHunk (size_t inDelete, size_t inInsert, CRange &outTarget, const CRange *inUnique = NULL);
+	size_t getHunkCost (size_t inDelete, size_t inInsert, const CRange &inTarget);
+
+	// Shrink unique range down to ioRange as long as it stays unique
+
+	void shrinkPattern (const CRange &inUnique, CRange &ioRange);
+
+	// Write the hunk located at inTarget and move past it
+
+	void outputHunk (size_t inDelete, size_t inInsert, const CRange &inTarget);
+
+	// Kept lines follow the edits collected
+
+	void keepLines (size_t inCount);
+
+	void outputHeld ();
+
+	// Hunk command along with the line its pattern starts at, if asked
+
+	void outputCommand (const char *inCommand, const CRange &inTarget);
+
+	typedef std::unordered_map<uint64_t, std::vector<size_t> > CLineIndex;
+
+	FILE *mOutFile;
+
+	COutputWriter mWriter;
+	
+	CDataSourceTextFile &mSource;
+	CDataSourceTextFile &mDest;
+
+	const CHashedString *mSourceLines;
+	const CHashedString *mDestLines;
+
+	CLineIndex mSourceIndex;	// line hash to its positions, ascending
+	CLineIndex mDestIndex;
+	
+	size_t mPosition;			// destination lines in front of the current position
+	size_t mSourcePosition;		// source lines consumed
+
+	// Source line every kept destination line comes from, -1 for inserted
+	// ones. Only filled under a whitespace mode
+
+	std::vector<size_t> mKeptSource;
+	size_t mScriptSource;		// lines of the edit script replayed so far
+	size_t mScriptDest;
+
+	CRange mToInsert;
+	CRange mToDelete;
+
+	// Hunk held at the current position and kept lines following it
+
+	bool mHeld;
+	size_t mHeldDelete;
+	size_t mHeldInsert;
+	size_t mHeldCost;			// -1 until the held hunk is located
+	CRange mHeldTarget;
+	size_t mGap;
+
+	size_t mMaxMergeGap;
+
+	bool mFingerprint;
+
+	CIntraline::EMode mIntraline;
+	std::string mEdits;
+};
+
+#endif	// __CChangeSetBuilder_h
@@ -1,323 +1,705 @@
-#include "stdafx.h"
-
-#include "CChangeSetProcessor.h"
-
-#include "CSccsApplication.h"
-
-
-//
-//	class CChangeSetProcessor
-//
-//  Keeps functionality to process change set and create Tb via Ta->(Cab)->Tb
-//
-
-CChangeSetProcessor::CChangeSetProcessor(
-	FILE *inFile1,		// reference file
-	FILE *inFile2,		// file to write to
-	FILE *inSetFile		// instruction changeset file
-) :
-	mFile1(inFile1), mFile2(inFile2), mSetFile(inSetFile)
-{
-}
-
-
-CChangeSetProcessor::~CChangeSetProcessor()
-{
-}
-
-
-void
-CChangeSetProcessor::addPattern(std::vector<CHashedString> &inBuffer)
-{
-	for (size_t i = 0; i < inBuffer.size(); i++)
-	{
-		mPattern.push_back(&inBuffer.at(i));
-	}
-}
-
-
-bool
-CChangeSetProcessor::readString(FILE *inFile, CHashedString &outString)
-{
-	THROW_IF(inFile == NULL, XBadParameter);
-
-	char buffer[4096] = "";
-
-	if (fgets(buffer, sizeof(buffer) / sizeof(buffer[0]), inFile) == NULL)
-	{
-		THROW_IF_NOT(feof(inFile), XCantRead);
-
-		outString = "";
-		return false;
-	}
-
-	// remove trailing \n or \r
-
-	char c;
-	int len;
-
-	while (((c = buffer[(len = strlen(buffer)) - 1]) == '\n') || (c == '\r'))
-	{
-		buffer[len - 1] = '\0';
-	}
-
-	outString = buffer;
-
-	return true;
-}
-
-
-short
-CChangeSetProcessor::readCommandPart(std::vector<CHashedString> *outBuffer)
-{
-	if (outBuffer != NULL)
-	{
-		outBuffer->clear();
-	}
-
-	for (;;)
-	{
-		CHashedString str;
-
-		THROW_IF_NOT_WINFO(readString(mSetFile, str), XBadDiff, "Expecting command part");
-
-		if (str[0] == '[')
-		{
-			// Strip trailing whitespaces if any
-
-			int pos = str.find_first_of(" \t");
-
-			if (pos != std::string::npos)
-			{
-				str.erase(pos);
-			}
-
-			if (strcmp(str.c_str(), "[BEGIN]") == 0)	return kBegin;
-			else if (strcmp(str.c_str(), "[END]") == 0)	return kEnd;
-			else if (strcmp(str.c_str(), "[INSERT]") == 0)	return kInsert;
-			else if (strcmp(str.c_str(), "[REPLACE]") == 0)	return kReplace;
-			else if (strcmp(str.c_str(), "[DELETE]") == 0)	return kDelete;
-			else if (strcmp(str.c_str(), "[BETWEEN]") == 0)	return kBetween;
-			else if (strcmp(str.c_str(), "[AND]") == 0)	return kAnd;
-			else if (strcmp(str.c_str(), "[WITH]") == 0)	return kWith;
-
-			// Unrecognized reserved word
-
-			str.insert(0, "Unrecognized command: ");
-
-			THROW_WINFO(XBadDiff, str.c_str());
-		}
-		else
-		{
-			THROW_IF_NOT_WINFO(outBuffer, XBadDiff, "Command word expected");
-
-			// Every non-command line must have prefix "> "
-
-			THROW_IF_WINFO(strncmp(str.c_str(), "> ", 2), XBadDiff,
-				"Non-command line without '> ' prefix");
-
-			// Remove prefix and addline to buffer
-
-			str.erase(0, 2);
-			outBuffer->push_back(str);
-		}
-	}
-}
-
-
-// Check pattern for uniqueness and presence,
-// locate it position in source, throw an exception if something wrong
-
-size_t
-CChangeSetProcessor::checkPattern()
-{
-	size_t dataSize = mData.size();
-	size_t patternSize = mPattern.size();
-
-	size_t position = -1;
-	bool b_found = false;
-
-	for (size_t i = 0; i <= dataSize - patternSize; i++)
-	{
-		size_t j;
-
-		for (j = 0; j < patternSize  &&
-			mPattern[j]->compare(mData[i + j]) == 0; j++)
-		{
-		}
-
-		if (j == patternSize)
-		{
-			// Context is not unique? Output 1st line of it and bail out
-
-			THROW_IF_WINFO(b_found, XAmbiguousContext, mPattern[0]->c_str());
-			position = i;
-
-			b_found = true;
-		}
-	}
-
-	THROW_IF_NOT_WINFO(b_found, XContextNotFound, mPattern[0]->c_str());
-
-	return position;
-}
-
-
-void
-CChangeSetProcessor::insertContext(size_t position, std::vector<CHashedString> &inBuffer)
-{
-	for (size_t i = 0; i < inBuffer.size(); i++)
-	{
-		mData.insert(mData.begin() + position + i, inBuffer[i]);
-	}
-}
-
-
-void
-CChangeSetProcessor::deleteContext(size_t position, size_t nlines)
-{
-	mData.erase(mData.begin() + position, mData.begin() + position + nlines);
-}
-
-
-// Main procession
-// [BEGIN] starts procession, and we don't care what happens after {END}
-
-void
-CChangeSetProcessor::process()
-{
-	// Load whole source file into memory for further operation,
-	// suppose files just opened and we do not need to rewind pointer
-
-	CHashedString str;
-
-	while (readString(mFile1, str))
-	{
-		mData.push_back(str);
-	}
-
-	// OK, first line of changeset must be [BEGIN]
-
-	THROW_IF_WINFO(readCommandPart() != kBegin, XBadDiff, "No [BEGIN] at file start");
-
-	short cmd = readCommandPart();
-
-	for (;;)
-	{
-		size_t pos;
-
-		switch (cmd)
-		{
-		case kEnd:
-
-			// This is the end, my only friend -- the end
-
-			outputResult();
-			return;
-
-		case kInsert:
-
-			cmd = readCommandPart(&mWhat);
-			THROW_IF_NOT_WINFO(cmd == kBetween, XBadDiff, "[BETWEEN] expected");
-
-			cmd = readCommandPart(&mBefore);
-			THROW_IF_NOT_WINFO(cmd == kAnd, XBadDiff, "[AND] expected");
-
-			// Command stored for next iteration
-
-			cmd = readCommandPart(&mAfter);
-
-			// Fill pattern
-
-			mPattern.clear();
-
-			addPattern(mBefore);
-			addPattern(mAfter);
-
-			pos = checkPattern();
-
-			// Update output file content
-
-			insertContext(pos + mBefore.size(), mWhat);
-
-			break;
-
-		case kDelete:
-
-			cmd = readCommandPart(&mWhat);
-			THROW_IF_NOT_WINFO(cmd == kBetween, XBadDiff, "[BETWEEN] expected");
-
-			cmd = readCommandPart(&mBefore);
-			THROW_IF_NOT_WINFO(cmd == kAnd, XBadDiff, "[AND] expected");
-
-			// Command stored for next iteration
-
-			cmd = readCommandPart(&mAfter);
-
-			// Fill pattern
-
-			mPattern.clear();
-
-			addPattern(mBefore);
-			addPattern(mWhat);
-			addPattern(mAfter);
-
-			pos = checkPattern();
-
-			// Update output file content
-
-			deleteContext(pos + mBefore.size(), mWhat.size());
-
-			break;
-
-		case kReplace:
-
-			cmd = readCommandPart(&mWhat);
-			THROW_IF_NOT_WINFO(cmd == kWith, XBadDiff, "[WITH] expected");
-
-			// Command stored for next iteration
-
-			cmd = readCommandPart(&mBefore);
-
-			// Fill pattern
-
-			mPattern.clear();
-
-			addPattern(mWhat);
-
-			pos = checkPattern();
-
-			// Update output file content
-			// mBefore keeps 'WITH' part
-
-			deleteContext(pos, mWhat.size());
-			insertContext(pos, mBefore);
-
-			break;
-		}
-	}
-}
-
-
-// Output current content of mData
-
-void
-CChangeSetProcessor::outputResult()
-{
-	THROW_IF_NULL(mFile2);
-
-	size_t dataSize = mData.size();
-
-	// Avoid output of \n for last line
-
-	if (dataSize > 0)
-	{
-		THROW_IF(fputs(mData[0].c_str(), mFile2) == EOF, XCantWrite);
-	}
-
-	for (size_t i = 1; i < dataSize; i++)
-	{
-		THROW_IF(fputc('\n', mFile2) == EOF, XCantWrite);
-		THROW_IF(fputs(mData[i].c_str(), mFile2) == EOF, XCantWrite);
-	}
-}
+#include "stdafx.h"
+
+#include "CChangeSetProcessor.h"
+
+#include "CSccsApplication.h"
+#include "COutputWriter.h"
+#include "CStats.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+
+//
+//	class CChangeSetProcessor
+//
+//  Keeps functionality to process change set and create Tb via Ta->(Cab)->Tb
+//
+
+CChangeSetProcessor::CChangeSetProcessor(
+	FILE *inFile1,		// reference file
+	FILE *inFile2,		// file to write to
+	FILE *inSetFile		// instruction changeset file
+) :
+	mFile1(inFile1), mFile2(inFile2), mSetFile(inSetFile), mResult(NULL),
+	mReader1(inFile1, true), mSetReader(new CLineReader(inSetFile)), mOwnSet(new CChangeSet()),
+	mSet(mOwnSet.get()), mSourceMatched(false), mSplicing(true), mPosition(-1), mDrift(0), mCursor(0),
+	mIndexed(false), mFuzz(0), mHunk(0), mCheckOnly(false), mApplicable(true), mIndexDirty(true)
+{
+	mSetReader->acceptCompressed();
+}
+
+
+CChangeSetProcessor::CChangeSetProcessor(
+	const char *inSource, size_t inSourceLength,
+	const char *inSet, size_t inSetLength,
+	std::string *outResult
+) :
+	mFile1(NULL), mFile2(NULL), mSetFile(NULL), mResult(outResult),
+	mReader1(inSource, inSourceLength), mSetReader(new CLineReader(inSet, inSetLength)), mOwnSet(new CChangeSet()),
+	mSet(mOwnSet.get()), mSourceMatched(false), mSplicing(true), mPosition(-1), mDrift(0), mCursor(0),
+	mIndexed(false), mFuzz(0), mHunk(0), mCheckOnly(false), mApplicable(true), mIndexDirty(true)
+{
+	THROW_IF_NULL(mResult);
+
+	mSetReader->acceptCompressed();
+}
+
+
+CChangeSetProcessor::CChangeSetProcessor(
+	FILE *inFile1,
+	FILE *inFile2,
+	const CChangeSet &inSet
+) :
+	mFile1(inFile1), mFile2(inFile2), mSetFile(NULL), mResult(NULL),
+	mReader1(inFile1, true), mSet(&inSet),
+	mSourceMatched(false), mSplicing(true), mPosition(-1), mDrift(0), mCursor(0),
+	mIndexed(false), mFuzz(0), mHunk(0), mCheckOnly(false), mApplicable(true), mIndexDirty(true)
+{
+}
+
+
+CChangeSetProcessor::~CChangeSetProcessor()
+{
+}
+
+
+void
+CChangeSetProcessor::addPattern(const std::vector<CHashedString> &inBuffer)
+{
+	for (size_t i = 0; i < inBuffer.size(); i++)
+	{
+		mPattern.push_back(&inBuffer.at(i));
+	}
+}
+
+
+bool
+CChangeSetProcessor::readString(CLineReader &inReader, CHashedString &outString)
+{
+	const char *line;
+	size_t len;
+
+	if (! inReader.readLine(&line, &len))
+	{
+		outString = "";
+		return false;
+	}
+
+	outString = CHashedString(line, len);
+
+	return true;
+}
+
+
+// Check pattern for uniqueness and presence,
+// locate it position in source, throw an exception if something wrong
+
+size_t
+CChangeSetProcessor::checkPattern(size_t inRequiredBegin, size_t inRequiredEnd)
+{
+	STATS_PHASE(kPhaseSearch);
+	STATS_COUNT(kPatternChecks, 1);
+
+	if (mSplicing  &&  ! mPattern.empty())
+	{
+		if (mSourceMatched  &&  mPosition != (size_t) -1  &&  matchesAt(mPosition))
+		{
+			return mPosition;
+		}
+
+		size_t hint = -1;
+
+		if (mPosition != (size_t) -1  &&  (mDrift >= 0  ||  mPosition >= (size_t) -mDrift))
+		{
+			hint = mPosition + mDrift;
+		}
+
+		size_t position = findIndexed(hint);
+
+		if (position != (size_t) -1)
+		{
+			if (mPosition != (size_t) -1)
+			{
+				mDrift = (ptrdiff_t) position - (ptrdiff_t) mPosition;
+			}
+
+			return position;
+		}
+
+		THROW_IF_WINFO(mFuzz == 0, XContextNotFound, mPattern[0]->c_str());
+
+		endSplice();
+	}
+
+	size_t dataSize = mData.size();
+	size_t patternSize = mPattern.size();
+
+	size_t position = -1;
+	bool b_found = false;
+
+	for (size_t i = 0; patternSize <= dataSize  &&  i <= dataSize - patternSize; i++)
+	{
+		size_t j;
+
+		for (j = 0; j < patternSize  &&
+			mPattern[j]->compare(mData[i + j]) == 0; j++)
+		{
+		}
+
+		if (j == patternSize)
+		{
+			// Context is not unique? Output 1st line of it and bail out
+
+			THROW_IF_WINFO(b_found, XAmbiguousContext, mPattern[0]->c_str());
+			position = i;
+
+			b_found = true;
+		}
+	}
+
+	if (! b_found  &&  mFuzz != 0)
+	{
+		return findFuzzyPattern(inRequiredBegin, inRequiredEnd);
+	}
+
+	THROW_IF_NOT_WINFO(b_found, XContextNotFound, mPattern[0]->c_str());
+
+	return position;
+}
+
+
+// Every pattern line votes for the starts its occurrences imply, so only starts
+// sharing enough lines with the pattern get compared at all. At least one context
+// line must match, and the best start must be the only one with its mismatch count
+
+size_t
+CChangeSetProcessor::findFuzzyPattern(size_t inRequiredBegin, size_t inRequiredEnd)
+{
+	size_t dataSize = mData.size();
+	size_t patternSize = mPattern.size();
+	size_t contextSize = patternSize - (inRequiredEnd - inRequiredBegin);
+
+	THROW_IF_WINFO(contextSize == 0  ||  patternSize > dataSize, XContextNotFound, mPattern[0]->c_str());
+
+	size_t maxFuzz = std::min(mFuzz, contextSize - 1);
+
+	if (mIndexDirty)
+	{
+		buildIndex();
+	}
+
+	std::unordered_map<size_t, size_t> votes;
+
+	for (size_t j = 0; j < patternSize; j++)
+	{
+		auto found = mIndex.find(mPattern[j]->getHashValue());
+
+		if (found == mIndex.end())
+		{
+			continue;
+		}
+
+		for (size_t line : found->second)
+		{
+			if (line >= j  &&  line - j + patternSize <= dataSize)
+			{
+				votes[line - j] ++;
+			}
+		}
+	}
+
+	size_t position = -1;
+	size_t bestFuzz = maxFuzz + 1;
+	bool b_tie = false;
+
+	for (const auto &vote : votes)
+	{
+		// Votes count equal hashes, so they only bound the matching lines
+
+		if (patternSize - vote.second > maxFuzz)
+		{
+			continue;
+		}
+
+		size_t fuzz = 0;
+		size_t j;
+
+		for (j = 0; j < patternSize; j++)
+		{
+			if (mPattern[j]->compare(mData[vote.first + j]) != 0)
+			{
+				if ((j >= inRequiredBegin  &&  j < inRequiredEnd)  ||  ++ fuzz > maxFuzz)
+				{
+					break;
+				}
+			}
+		}
+
+		if (j < patternSize)
+		{
+			continue;
+		}
+
+		if (fuzz < bestFuzz)
+		{
+			position = vote.first;
+			bestFuzz = fuzz;
+			b_tie = false;
+		}
+		else if (fuzz == bestFuzz)
+		{
+			b_tie = true;
+		}
+	}
+
+	THROW_IF_WINFO(bestFuzz > maxFuzz, XContextNotFound, mPattern[0]->c_str());
+	THROW_IF_WINFO(b_tie, XAmbiguousContext, mPattern[0]->c_str());
+
+	CFuzzReport report = { mHunk, position + 1, bestFuzz };
+	mFuzzReport.push_back(report);
+
+	return position;
+}
+
+
+void
+CChangeSetProcessor::buildIndex()
+{
+	mIndex.clear();
+
+	for (size_t i = 0; i < mData.size(); i++)
+	{
+		mIndex[mData[i].getHashValue()].push_back(i);
+	}
+
+	mIndexDirty = false;
+}
+
+
+bool
+CChangeSetProcessor::matchesAt(size_t inPosition) const
+{
+	size_t patternSize = mPattern.size();
+
+	if (inPosition > getLineCount()  ||  patternSize > getLineCount() - inPosition)
+	{
+		return false;
+	}
+
+	for (size_t j = 0; j < patternSize; j++)
+	{
+		if (mPattern[j]->compare(getLine(inPosition + j)) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Any place of the pattern holds its rarest line at the same offset, so only
+// the places of that line are compared, the hint first
+
+size_t
+CChangeSetProcessor::findIndexed(size_t inHint)
+{
+	if (! mIndexed)
+	{
+		for (size_t i = mCursor; i < mData.size(); i++)
+		{
+			mSourceIndex[mData[i].getHashValue()].push_back(i);
+		}
+
+		mIndexed = true;
+
+		indexSpliced(0);
+	}
+
+	const std::vector<size_t> *splicedHits = NULL;
+	const std::vector<size_t> *sourceHits = NULL;
+	std::vector<size_t>::const_iterator sourceFrom;
+
+	size_t offset = 0;
+	size_t best = -1;
+
+	for (size_t j = 0; j < mPattern.size()  &&  best > 0; j++)
+	{
+		uint64_t hash = mPattern[j]->getHashValue();
+
+		CLineIndex::const_iterator spliced = mSplicedIndex.find(hash);
+		CLineIndex::const_iterator source = mSourceIndex.find(hash);
+
+		size_t count = (spliced != mSplicedIndex.end()) ? spliced->second.size() : 0;
+		std::vector<size_t>::const_iterator from;
+
+		if (source != mSourceIndex.end())
+		{
+			from = std::lower_bound(source->second.begin(), source->second.end(), mCursor);
+			count += source->second.end() - from;
+		}
+
+		if (count < best)
+		{
+			best = count;
+			offset = j;
+			splicedHits = (spliced != mSplicedIndex.end()) ? &spliced->second : NULL;
+			sourceHits = (source != mSourceIndex.end()) ? &source->second : NULL;
+			sourceFrom = from;
+		}
+	}
+
+	size_t position = -1;
+
+	if (inHint != (size_t) -1  &&  matchesAt(inHint))
+	{
+		position = inHint;
+	}
+
+	auto tryLine = [&] (size_t inLine)
+	{
+		if (inLine < offset  ||  inLine - offset == position  ||  ! matchesAt(inLine - offset))
+		{
+			return;
+		}
+
+		// Context is not unique? Output 1st line of it and bail out
+
+		THROW_IF_WINFO(position != (size_t) -1, XAmbiguousContext, mPattern[0]->c_str());
+
+		position = inLine - offset;
+	};
+
+	if (splicedHits != NULL)
+	{
+		for (size_t line : *splicedHits)
+		{
+			tryLine(line);
+		}
+	}
+
+	if (sourceHits != NULL)
+	{
+		for (std::vector<size_t>::const_iterator it = sourceFrom; it != sourceHits->end(); ++it)
+		{
+			tryLine(*it - mCursor + mSpliced.size());
+		}
+	}
+
+	return position;
+}
+
+
+void
+CChangeSetProcessor::indexSpliced(size_t inFrom)
+{
+	if (mIndexed)
+	{
+		for (size_t i = inFrom; i < mSpliced.size(); i++)
+		{
+			mSplicedIndex[mSpliced[i].getHashValue()].push_back(i);
+		}
+	}
+}
+
+
+bool
+CChangeSetProcessor::spliceTo(size_t inPosition)
+{
+	if (inPosition < mSpliced.size())
+	{
+		endSplice();
+		return false;
+	}
+
+	size_t count = inPosition - mSpliced.size();
+
+	THROW_IF_WINFO(count > mData.size() - mCursor, XBadDiff, "Hunk past the end of text");
+
+	size_t from = mSpliced.size();
+
+	mSpliced.insert(mSpliced.end(), std::make_move_iterator(mData.begin() + mCursor),
+		std::make_move_iterator(mData.begin() + mCursor + count));
+
+	mCursor += count;
+
+	indexSpliced(from);
+
+	return true;
+}
+
+
+void
+CChangeSetProcessor::endSplice()
+{
+	if (! mSplicing)
+	{
+		return;
+	}
+
+	mSpliced.insert(mSpliced.end(), std::make_move_iterator(mData.begin() + mCursor),
+		std::make_move_iterator(mData.end()));
+
+	mData.swap(mSpliced);
+
+	mSpliced.clear();
+	mCursor = 0;
+
+	mSourceIndex.clear();
+	mSplicedIndex.clear();
+	mIndexed = false;
+
+	mSplicing = false;
+	mIndexDirty = true;
+}
+
+
+void
+CChangeSetProcessor::insertContext(size_t position, const std::vector<CHashedString> &inBuffer)
+{
+	STATS_PHASE(kPhaseEdit);
+
+	if (mSplicing  &&  spliceTo(position))
+	{
+		size_t from = mSpliced.size();
+
+		mSpliced.insert(mSpliced.end(), inBuffer.begin(), inBuffer.end());
+
+		indexSpliced(from);
+		return;
+	}
+
+	mIndexDirty = true;
+
+	mData.insert(mData.begin() + position, inBuffer.begin(), inBuffer.end());
+}
+
+
+void
+CChangeSetProcessor::deleteContext(size_t position, size_t nlines)
+{
+	STATS_PHASE(kPhaseEdit);
+
+	if (mSplicing  &&  spliceTo(position))
+	{
+		THROW_IF_WINFO(nlines > mData.size() - mCursor, XBadDiff, "Hunk past the end of text");
+
+		mCursor += nlines;
+		return;
+	}
+
+	mIndexDirty = true;
+
+	mData.erase(mData.begin() + position, mData.begin() + position + nlines);
+}
+
+
+// Main procession
+
+void
+CChangeSetProcessor::process()
+{
+	// Load whole source file into memory for further operation,
+	// suppose files just opened and we do not need to rewind pointer
+
+	{
+		STATS_PHASE(kPhaseRead);
+
+		CHashedString str;
+
+		while (readString(mReader1, str))
+		{
+			mData.push_back(std::move(str));
+		}
+
+		STATS_COUNT(kLinesRead, mData.size());
+	}
+
+	if (mOwnSet)
+	{
+		mOwnSet->read(*mSetReader);
+	}
+
+	if (mSet->hasSource())
+	{
+		STATS_PHASE(kPhaseRead);
+
+		CFingerprint input;
+
+		for (const CHashedString &line : mData)
+		{
+			input.addLine(line.data(), line.size());
+		}
+
+		mSourceMatched = (input == mSet->getSource());
+	}
+
+	for (const CChangeSet::CHunk &hunk : mSet->getHunks())
+	{
+		mHunk ++;
+		mPosition = hunk.mLine;
+
+		if (! applyHunk(hunk))
+		{
+			mApplicable = false;
+		}
+	}
+
+	endSplice();
+
+	if (mSourceMatched  &&  mSet->hasTarget()  &&  mApplicable)
+	{
+		CFingerprint result;
+
+		for (const CHashedString &line : mData)
+		{
+			result.addLine(line.data(), line.size());
+		}
+
+		THROW_IF_WINFO(result != mSet->getTarget(), XBadDiff, "Result does not match the target fingerprint");
+	}
+
+	if (! mCheckOnly)
+	{
+		outputResult();
+	}
+}
+
+
+bool
+CChangeSetProcessor::applyHunk(const CChangeSet::CHunk &inHunk)
+{
+	// Fill pattern
+
+	mPattern.clear();
+
+	size_t required = 0;
+	size_t pos = 0;
+
+	switch (inHunk.mCommand)
+	{
+	case CChangeSet::kInsert:
+
+		addPattern(inHunk.mBefore);
+		addPattern(inHunk.mAfter);
+		break;
+
+	case CChangeSet::kDelete:
+
+		addPattern(inHunk.mBefore);
+		addPattern(inHunk.mWhat);
+		addPattern(inHunk.mAfter);
+
+		required = inHunk.mBefore.size();
+		break;
+
+	case CChangeSet::kReplace:
+
+		addPattern(inHunk.mWhat);
+		break;
+	}
+
+	size_t fuzzReports = mFuzzReport.size();
+	EHunkStatus status = kHunkApplies;
+
+	try
+	{
+		pos = checkPattern(required, (inHunk.mCommand != CChangeSet::kInsert) ? required + inHunk.mWhat.size() : 0);
+	}
+	catch (const XContextNotFound &)
+	{
+		if (! mCheckOnly)
+		{
+			throw;
+		}
+
+		status = kHunkNotFound;
+	}
+	catch (const XAmbiguousContext &)
+	{
+		if (! mCheckOnly)
+		{
+			throw;
+		}
+
+		status = kHunkAmbiguous;
+	}
+
+	if (mCheckOnly)
+	{
+		CHunkStatus report = { mHunk, 0, 0, status, std::string() };
+
+		if (status == kHunkApplies)
+		{
+			report.mLine = pos + 1;
+			report.mFuzz = (mFuzzReport.size() > fuzzReports) ? mFuzzReport.back().mFuzz : 0;
+		}
+		else if (! mPattern.empty())
+		{
+			report.mContext = *mPattern[0];
+		}
+
+		mHunkStatus.push_back(report);
+	}
+
+	if (status != kHunkApplies)
+	{
+		return false;
+	}
+
+	// Update output file content
+
+	switch (inHunk.mCommand)
+	{
+	case CChangeSet::kInsert:
+
+		insertContext(pos + inHunk.mBefore.size(), inHunk.mWhat);
+		break;
+
+	case CChangeSet::kDelete:
+
+		deleteContext(pos + inHunk.mBefore.size(), inHunk.mWhat.size());
+		break;
+
+	case CChangeSet::kReplace:
+
+		deleteContext(pos, inHunk.mWhat.size());
+		insertContext(pos, inHunk.mWith);
+		break;
+	}
+
+	return true;
+}
+
+
+// Output current content of mData
+
+void
+CChangeSetProcessor::outputResult()
+{
+	THROW_IF(mFile2 == NULL  &&  mResult == NULL, XNullPointer);
+
+	// mData outlives the writer, so lines are referenced, not copied
+
+	std::unique_ptr<COutputWriter> writer((mResult != NULL) ?
+		new COutputWriter(mResult) : new COutputWriter(mFile2));
+
+	size_t dataSize = mData.size();
+
+	// Avoid output of \n for last line
+
+	if (dataSize > 0)
+	{
+		writer->writeRef(mData[0]);
+	}
+
+	for (size_t i = 1; i < dataSize; i++)
+	{
+		writer->write('\n');
+		writer->writeRef(mData[i]);
+	}
+
+	writer->flush();
+}
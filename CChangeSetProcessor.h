@@ -1,82 +1,219 @@
-#ifndef __CChangeSetProcessor_h
-#define __CChangeSetProcessor_h
-
-#include <vector>
-
-#include "CCompare.h"
-#include "CDataSourceTextFile.h"
-
-DECLARE_EXCEPTION(XBadDiff, XRuntime, "Corrupted change set file");
-DECLARE_EXCEPTION(XContextNotFound, XRuntime, "Context not found");
-DECLARE_EXCEPTION(XAmbiguousContext, XRuntime, "Context not unique");
-
-
-//
-//	class CChangeSetProcessor
-//
-//  Keeps functionality to process change set and create Tb via Ta->(Cab)->Tb
-//
-
-class CChangeSetProcessor
-{
-public:
-
-	enum
-	{
-		kNone = 0,
-		kBegin = 1,
-		kEnd = 2,
-		kInsert = 3,
-		kReplace = 4,
-		kDelete = 5,
-		kBetween = 6,
-		kAnd = 7,
-		kWith = 8
-	};
-
-	CChangeSetProcessor(
-		FILE *inFile1,		// reference file
-		FILE *inFile2,		// file to write to
-		FILE *inSetFile		// instruction changeset file
-	);
-
-	virtual ~CChangeSetProcessor();
-
-	void addPattern(std::vector<CHashedString> &inBuffer);
-
-	bool readString(FILE *inFile, CHashedString &outString);
-
-	short readCommandPart(std::vector<CHashedString> *outBuffer = NULL);
-
-	// Check pattern for uniqueness and presence,
-	// locate it position in source, throw an exception if something wrong
-
-	size_t checkPattern();
-
-	void insertContext(size_t position, std::vector<CHashedString> &inBuffer);
-	void deleteContext(size_t position, size_t nlines);
-
-	// Main procession
-
-	void process();
-
-	// Output current content of mData
-
-	void outputResult();
-
-protected:
-
-	FILE * mFile1;
-	FILE *mFile2;
-	FILE *mSetFile;
-
-	std::vector<CHashedString>  mData;	// processed data (from source to dest)
-
-	std::vector<CHashedString>  mWhat;	// command buffer
-	std::vector<CHashedString>  mBefore;	// note, 'before' comes before insert position
-	std::vector<CHashedString>  mAfter;
-
-	std::vector<const CHashedString *>  mPattern;
-};
-
-#endif	// __CChangeSetProcessor_h
+#ifndef __CChangeSetProcessor_h
+#define __CChangeSetProcessor_h
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "CChangeSet.h"
+#include "CCompare.h"
+#include "CDataSourceTextFile.h"
+#include "CLineReader.h"
+
+DECLARE_EXCEPTION(XContextNotFound, XRuntime, "Context not found");
+DECLARE_EXCEPTION(XAmbiguousContext, XRuntime, "Context not unique");
+
+
+//
+//	class CChangeSetProcessor
+//
+//  Keeps functionality to process change set and create Tb via Ta->(Cab)->Tb
+//
+//	Hunks come in text order, so they are spliced in a single pass: the text
+//	is the lines spliced so far followed by the source ones past a cursor.
+//	Patterns are looked up by the places of their rarest line in an index of
+//	both parts, the line a hunk command carries, shifted as much as the last
+//	hunk was, is tried first. A hunk out of order or one matching with fuzz
+//	only ends the splicing, the rest is searched in the whole text.
+//
+//	When [BEGIN] carries the fingerprint of Ta and the source has it, a pattern
+//	found at the line of its command is known to be unique, nothing is looked
+//	up then. The result of such source is checked against the fingerprint of Tb
+//
+
+class CChangeSetProcessor
+{
+public:
+
+	CChangeSetProcessor(
+		FILE *inFile1,		// reference file
+		FILE *inFile2,		// file to write to
+		FILE *inSetFile		// instruction changeset file
+	);
+
+	// Same for memory buffers, they must outlive the processor,
+	// the result is appended to the string
+
+	CChangeSetProcessor(
+		const char *inSource, size_t inSourceLength,
+		const char *inSet, size_t inSetLength,
+		std::string *outResult
+	);
+
+	// Apply a change set read already, it must outlive the processor.
+	// inFile2 may be NULL when only checking
+
+	CChangeSetProcessor(
+		FILE *inFile1,
+		FILE *inFile2,
+		const CChangeSet &inSet
+	);
+
+	virtual ~CChangeSetProcessor();
+
+	// Hunk applied at a partial match of its context
+
+	struct CFuzzReport
+	{
+		size_t mHunk;		// 1-based, in changeset order
+		size_t mLine;		// 1-based line the pattern starts at
+		size_t mFuzz;		// mismatching context lines
+	};
+
+	// Tolerate up to inFuzz mismatching context lines when a context is missing,
+	// 0 (default) requires exact contexts
+
+	void setFuzz(size_t inFuzz) { mFuzz = inFuzz; }
+
+	const std::vector<CFuzzReport> &getFuzzReport() const { return mFuzzReport; }
+
+	// How every hunk went when only checking
+
+	enum EHunkStatus
+	{
+		kHunkApplies,
+		kHunkNotFound,
+		kHunkAmbiguous
+	};
+
+	struct CHunkStatus
+	{
+		size_t mHunk;			// 1-based, in changeset order
+		size_t mLine;			// 1-based line the pattern starts at, 0 if not found
+		size_t mFuzz;			// mismatching context lines
+		EHunkStatus mStatus;
+		std::string mContext;	// first pattern line
+	};
+
+	// Check every hunk rather than throw at the first one not applying, and
+	// write nothing. The hunks that do not apply are skipped, so the following
+	// ones are checked against the text without them
+
+	void setCheckOnly(bool inCheckOnly) { mCheckOnly = inCheckOnly; }
+
+	const std::vector<CHunkStatus> &getHunkStatus() const { return mHunkStatus; }
+
+	// All hunks apply
+
+	bool isApplicable() const { return mApplicable; }
+
+	void addPattern(const std::vector<CHashedString> &inBuffer);
+
+	bool readString(CLineReader &inReader, CHashedString &outString);
+
+	// Check pattern for uniqueness and presence,
+	// locate it position in source, throw an exception if something wrong.
+	// Pattern lines in [inRequiredBegin, inRequiredEnd) are the ones edited,
+	// they must match even when fuzz is allowed
+
+	size_t checkPattern(size_t inRequiredBegin = 0, size_t inRequiredEnd = 0);
+
+	void insertContext(size_t position, const std::vector<CHashedString> &inBuffer);
+	void deleteContext(size_t position, size_t nlines);
+
+	// Main procession
+
+	void process();
+
+	// Output current content of mData
+
+	void outputResult();
+
+protected:
+
+	// Best partial match of the pattern, candidates come from the line index
+
+	size_t findFuzzyPattern(size_t inRequiredBegin, size_t inRequiredEnd);
+
+	void buildIndex();
+
+	// Locate and apply the hunk, false if it does not apply when only checking
+
+	bool applyHunk(const CChangeSet::CHunk &inHunk);
+
+	// Lines of the text while splicing
+
+	size_t getLineCount() const { return mSpliced.size() + mData.size() - mCursor; }
+
+	const CHashedString &getLine(size_t inIndex) const
+	{
+		return (inIndex < mSpliced.size()) ? mSpliced[inIndex] : mData[inIndex - mSpliced.size() + mCursor];
+	}
+
+	bool matchesAt(size_t inPosition) const;
+
+	// The only place of the pattern, -1 if there is none
+
+	size_t findIndexed(size_t inHint);
+
+	void indexSpliced(size_t inFrom);
+
+	// Copy source lines up to the position, false if it was passed already
+
+	bool spliceTo(size_t inPosition);
+
+	// Join the rest of the source, mData holds the whole text again
+
+	void endSplice();
+
+	FILE * mFile1;
+	FILE *mFile2;
+	FILE *mSetFile;
+	std::string *mResult;
+
+	CLineReader mReader1;
+
+	// Change set read by the processor itself, or shared
+
+	std::unique_ptr<CLineReader> mSetReader;
+	std::unique_ptr<CChangeSet> mOwnSet;
+	const CChangeSet *mSet;
+
+	std::vector<CHashedString>  mData;	// processed data (from source to dest)
+
+	std::vector<const CHashedString *>  mPattern;
+
+	bool mSourceMatched;	// source has the fingerprint of [BEGIN]
+
+	// Splicing state
+
+	bool mSplicing;
+	size_t mPosition;		// line of the current hunk command, -1 if unknown
+	ptrdiff_t mDrift;		// how far from its line the last hunk was found
+	size_t mCursor;			// source lines consumed while splicing
+	std::vector<CHashedString> mSpliced;
+
+	// Line hash -> ascending positions in mData and in mSpliced, built by the
+	// first lookup
+
+	typedef std::unordered_map<uint64_t, std::vector<size_t> > CLineIndex;
+
+	CLineIndex mSourceIndex;
+	CLineIndex mSplicedIndex;
+	bool mIndexed;
+
+	size_t mFuzz;
+	size_t mHunk;
+	std::vector<CFuzzReport> mFuzzReport;
+
+	bool mCheckOnly;
+	bool mApplicable;
+	std::vector<CHunkStatus> mHunkStatus;
+
+	// Line hash -> positions in mData, rebuilt on demand after edits
+
+	std::unordered_map<uint64_t, std::vector<size_t> > mIndex;
+	bool mIndexDirty;
+};
+
+#endif	// __CChangeSetProcessor_h
@@ -1,421 +1,1740 @@
-#ifndef __CCompare_h
-#define __CCompare_h
-
-#include <string>
-#include <vector>
-#include <algorithm>
-
-#include "XExceptions.h"
-
-namespace cmp {
-
-// template function to determine if a pointer to a type points to
-// a null value, we also return true if the pointer itself is null
-
-template<typename T>
-inline bool isNull (T *t)
-{
-    return t == 0  ||  *t == NULL;
-}
-
-
-// template class to determine if the contents of two pointer are equivalent
-
-template<typename T>
-inline bool isEqualTo (const T * const t1, const T * const t2)
-{
-    THROW_IF (t1 == nullptr  ||  t2 == nullptr, XBadParameter);
-    return (*t1 == *t2);
-}
-
-
-//
-//	class CDataSource
-//
-//	Basic data provider template class for integral types.
-//	This class can be used to provide the CCompare class with
-//	data from an array of integral types to be compared
-//
-//     const char str[] = "a string to compare";
-//     cmp::CDataSource<const char> compareData1(str, strlen(str));
-//
-
-template<typename T>
-class CDataSource
-{
-  public:
-
-    // public typedef to define the data type
-    typedef T data_type;
-
-  private:
-    const T *mData;         // pointer to the data block
-    const T *mSource;       // pointer to the source data block
-    size_t   mSize;         // length of the data block
-
-  private:
-
-	// prevent compiler autogeneration
-	CDataSource();
-    CDataSource(const CDataSource &);
-	CDataSource &operator=(const CDataSource &);
-
-  public:
-
-    // taking a pointer to the data and the size of the data
-    CDataSource(const T * const data, size_t size) :
-		mData(0),
-		mSource(data),
-		mSize(size)
-	{
-	}
-
-	virtual ~CDataSource() { }
-
-    // all data source classes must define the following interface
-    void clearData() { }
-    
-	bool getAt(size_t index, const data_type **data) const 
-	{
-		*data = &mData[index];
-		return true;
-	}
-
-    const T * const getBaseData() const   { return mData; }
-    size_t getSize() const { return (mData == 0)? 0 : mSize; }
-
-	// fill the data buffer
-    void retrieveData()
-	{
-		mData = mSource;
-		mSource = 0;
-	}
-};
-
-
-// public typedefs for the record types
-
-enum CRecordType
-{
-    kUndefined=0,
-    kKeep,       // record is in both
-    kRemove,     // record is in the first, but not the second
-    kInsert      // record is in the second, but not the first
-};
-
-
-//
-//	class CResultType
-//
-//	Used to describe each result
-//
-
-template<typename T>
-class CResultType
-{
-  private:
-    size_t              mRecNum;  // record number
-    CRecordType         mType;    // record type (see enum above)
-    typename const T::data_type &mData;     // record data
-
-  protected:
-
-	// prevent compiler autogeneration
-	CResultType();
-    CResultType(const CResultType&);
-	CResultType &operator=(const CResultType&);
-
-  public:
-
-    // just stores the data
-    CResultType(size_t rec_num, CRecordType type, typename const T::data_type &data)
-      : mRecNum(rec_num),
-        mType(type),
-        mData(data)
-    {
-    }
-
-    ~CResultType() { }
-
-    // public accessors
-    size_t             recNum()  const  { return mRecNum; }
-    CRecordType         type()    const  { return mType; }
-	typename const T::data_type &data()   const  { return mData; }
-};
-
-
-//
-//	class CCompare
-//
-//	Primary class that does all the work
-//
-
-template<typename T>
-class CCompare
-{
-  public:
-
-    // define a typedef for the results
-    typedef std::vector<CResultType<T> *> CResultSet;
-
-  private:
-    short  *mArray;    // lcs working array
-    T      *mSource;   // first data source
-    T      *mDest;     // second data source
-
-  private:
-
-	// prevent compiler autogeneration
-	CCompare();
-    CCompare(const CCompare &);
-	CCompare &operator=(const CCompare &);
-
-  protected:
-    short getResult(int col, int row) const
-		{ return mArray[(row * mSource->getSize()) + col]; }
-
-    bool  getResultSet(CCompare<T>::CResultSet *pseq) const;
-    void  setResult(int col, int row, short v)
-		{ mArray[(row * mSource->getSize ()) + col] = v; }
-
-  public:
-
-    CCompare(T *source, T *dest);
-    ~CCompare();
-
-    int  process(CCompare<T>::CResultSet *pseq);
-};
-
-
-// just stores the data pointers
-
-template<typename T>
-CCompare<T>::CCompare(T *source, T *dest)
-  : mArray(NULL),
-    mSource(source),
-    mDest(dest)
-{
-}
-
-
-// free allocated memory
-
-template<typename T>
-CCompare<T>::~CCompare<T>()
-{
-    if (mArray != NULL)
-    {
-        delete mArray;
-        mArray = NULL;
-    }
-}
-
-
-// this is the main function
-// we calculate the lcs array and return the lcs length
-
-template<typename T>
-int CCompare<T>::process(CCompare<T>::CResultSet *pseq)
-{
-    mDest->clearData();
-    mDest->retrieveData();
-    mSource->clearData();
-    mSource->retrieveData();
-
-    // if we're at the end of both data streams,
-    // then return -1 to indicate the end
-
-    if (mSource->getSize () == 0  &&  mDest->getSize () == 0)
-    {
-        return -1;
-    }
-
-    // if the two data sources are equal size, then try
-    // a quick memcmp first. this avoids unnecessary
-    // processing using the slower lcs algorithm
-
-    const void * const baseData1 = mSource->getBaseData ();
-    const void * const baseData2 = mDest->getBaseData ();
-
-    if (baseData1 != NULL  &&  baseData2 != NULL
-	    &&  mSource->getSize() == mDest->getSize()
-		&&  memcmp(baseData1, baseData2, mSource->getSize()) == 0)
-    {
-		LOG_LINE ("Identical sources");
-        return mSource->getSize();
-    }
-
-    // allocate an array for the results. if the allocation
-    // fails, return -1 to indicate failure
-
-    if (mArray != NULL)
-    {
-        delete mArray;
-        mArray = NULL;
-    }
-
-    // calculate the size of the lcs working array
-
-    size_t size = (1 + mSource->getSize()) * (1 + mDest->getSize());
-
-    if (size > 1)
-    {
-		LOG_LINE("Allocating "  << size << " bytes");
-        mArray = new short[size];
-        THROW_IF (mArray == NULL, XNotEnoughMemory);
-		
-        LOG_LINE("Compare< " << typeid(T).name() << "> processing type \'" <<
-			typeid(T::data_type).name() << "\'");
-
-        // initialise the array
-        memset(mArray, 0x0, size);
-
-        // work through the array, right to left, bottom to top
-        int col,row;
-        for (col = mSource->getSize(); col >= 0; --col)
-        {
-            for (row=mDest->getSize(); row >= 0; --row)
-            {
-                const T::data_type *data1, *data2;
-
-                // get the data at the current col,row for each data source
-                if (mSource->getAt(col, &data1)  &&  mDest->getAt(row, &data2))
-                {
-                    if (isNull(data1)  ||  isNull(data2))
-                    {
-                        // if either data is null, set the array entry to zero
-                        this->setResult(col, row, 0);
-                    }
-                    else if (cmp::isEqualTo(data1, data2))
-                    {
-                        // if the data for each source is equal, then add one
-                        // to the value at the previous diagonal location - to
-                        // the right and below - and store it in the current location
-                        this->setResult(col, row, short(1) + this->getResult(col+1, row+1));
-                    }
-                    else
-                    {
-                        // if the data is not null and not equal, then copy
-                        // the maximum value from the two cells to the right
-                        // and below, into the current location
-                        this->setResult(col, row, std::max(this->getResult(col + 1, row),
-                                                                 this->getResult(col, row + 1)));
-                    }
-
-                }
-                else
-                    return -1;      // something went wrong
-            }   // each row
-        }       // each column
-    }
-
-    // return the length of the LCS
-    return this->getResultSet(pseq)? this->getResult(0, 0) : -1;
-}
-
-
-// construct result set and return to the caller
-
-template<typename T>
-bool CCompare<T>::getResultSet(CCompare<T>::CResultSet *pseq) const
-{
-    size_t col = 0;
-    size_t row = 0;
-    const T::data_type *data1, *data2;
-
-	size_t ncols = mSource->getSize();
-	size_t nrows = mDest->getSize();
-	
-    while (col < ncols  ||  row < nrows)
-    {
-		mSource->getAt(col, &data1);
-		mDest->getAt(row, &data2);
-		
-        if (col < ncols  &&  row < nrows  &&  cmp::isEqualTo(data1, data2))
-		{
-			THROW_IF(isNull(data1)  ||  isNull(data2), XRuntime);
-			
-			col ++;
-			row ++;
-
-			pseq->push_back(new CResultType<T>(col, cmp::kKeep, *data1));
-		}
-		else if (col < ncols  &&
-			(row == nrows  ||  this->getResult(col+1, row) > this->getResult(col, row+1)))
-		{
-			THROW_IF(isNull(data1), XRuntime);
-			col ++;
-
-			pseq->push_back(new CResultType<T>(col, cmp::kRemove, *data1));
-		}
-		else if (row < nrows && 
-			(col == ncols  ||  this->getResult(col+1, row) <= this->getResult(col, row+1)))
-		{
-			THROW_IF(isNull(data2), XRuntime);
-			row ++;
-
-			pseq->push_back(new CResultType<T>(row, cmp::kInsert, *data2));
-		}
-        else
-            return false;       // something went wrong
-	}
-
-    return true;
-}
-
-
-// small test function to calculate the difference
-// between two character strings
-
-inline void testCharacterDiff(const char * const str1, const char * const str2)
-{
-    // instantiate data source objects for each text string
-    cmp::CDataSource<const char> compare_data1(str1, strlen(str1));
-    cmp::CDataSource<const char> compare_data2(str2, strlen(str2));
-
-    // we need to instantiate a template compare object
-    // create a typedef first so that we can use a short-handed
-    // version later
-    typedef cmp::CCompare< cmp::CDataSource<const char> > compare_t;
-    compare_t compare(&compare_data1, &compare_data2);
-
-    size_t                lcs;
-    std::string           result_str1, result_str2;
-    compare_t::CResultSet seq;
-
-    // process the data sources
-    if ((lcs = compare.process(&seq)) != -1)
-    {
-        printf("Comparing: \"%s\" & \"%s\"\n"
-               "Longest Common Subsequence length is %d\n", str1, str2, lcs);
-
-        compare_t::CResultSet::iterator it   = seq.begin();
-        compare_t::CResultSet::iterator ite  = seq.end();
-        for (; it != ite; ++it)
-        {
-            compare_t::CResultSet::value_type res = *it;
-            if (res->type() == cmp::kRemove)
-            {
-                result_str1 += res->data();
-                result_str2 += '_';
-            }
-            else if (res->type() == cmp::kInsert)
-            {
-                result_str1 += '_';
-                result_str2 += res->data();
-            }
-            else
-            {
-                result_str1 += res->data();
-                result_str2 += res->data();
-            }
-        }
-        seq.erase(seq.begin(), seq.end());
-    }
-
-    printf("%s\n%s\n\n", result_str1.c_str(), result_str2.c_str());
-}
-
-}   // namespace cmp
-
-#endif  // __CCompare_h
+#ifndef __CCompare_h
+#define __CCompare_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <future>
+#include <type_traits>
+#include <unordered_map>
+#include <limits.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#include <sys/mman.h>
+#endif
+
+#include "XExceptions.h"
+#include "CStats.h"
+#include "CThreadPool.h"
+
+namespace cmp {
+
+// template function to determine if a pointer to a type points to
+// a null value, we also return true if the pointer itself is null
+
+template<typename T>
+inline bool isNull (T *t)
+{
+    return t == 0  ||  *t == NULL;
+}
+
+
+// template class to determine if the contents of two pointer are equivalent,
+// it is called unqualified, so data types may provide their own overloads
+
+template<typename T>
+inline bool isEqualTo (const T * const t1, const T * const t2)
+{
+    THROW_IF (t1 == nullptr  ||  t2 == nullptr, XBadParameter);
+    return (*t1 == *t2);
+}
+
+
+// template function to hash the contents of a pointer, used to find
+// records unique in both sources. it is called unqualified like isEqualTo
+
+template<typename T>
+inline uint64_t hashOf (const T * const t)
+{
+    THROW_IF (t == nullptr, XBadParameter);
+    return std::hash<typename std::remove_cv<T>::type>()(*t);
+}
+
+
+// default equality predicate of CCompare. integral records are compared
+// in place, others through the unqualified isEqualTo like before
+
+template<typename D>
+struct CEqualTo
+{
+    bool operator()(const D * const d1, const D * const d2) const
+    {
+        return equal(d1, d2, std::is_integral<D>());
+    }
+
+  private:
+    static bool equal(const D * const d1, const D * const d2, std::true_type)
+    {
+        return *d1 == *d2;
+    }
+
+    static bool equal(const D * const d1, const D * const d2, std::false_type)
+    {
+        return isEqualTo(d1, d2);
+    }
+};
+
+
+// data sources keeping their records in one array expose it by getData(),
+// they are then read by plain pointer arithmetic instead of getAt() calls
+
+template<typename T>
+class CSourceTraits
+{
+    template<typename U>
+    static std::true_type test(decltype(std::declval<const U &>().getData()) *);
+
+    template<typename U>
+    static std::false_type test(...);
+
+  public:
+    static const bool kContiguous = decltype(test<T>(0))::value;
+};
+
+
+//
+//	class CSourceAccess
+//
+//	Record access policy of CCompare, bound once the source is loaded.
+//	Only indices below the source size may be asked for
+//
+
+template<typename T, bool Contiguous = CSourceTraits<T>::kContiguous>
+class CSourceAccess
+{
+  public:
+    typedef typename T::data_type data_type;
+
+    CSourceAccess() : mSource(NULL) { }
+
+    void bind(const T *source) { mSource = source; }
+
+    const data_type *at(size_t index) const
+    {
+        const data_type *data;
+
+        THROW_IF (! mSource->getAt(index, &data), XRuntime);
+
+        return data;
+    }
+
+  private:
+    const T *mSource;
+};
+
+
+template<typename T>
+class CSourceAccess<T, true>
+{
+  public:
+    typedef typename T::data_type data_type;
+
+    CSourceAccess() : mData(NULL) { }
+
+    void bind(const T *source) { mData = source->getData(); }
+
+    const data_type *at(size_t index) const { return mData + index; }
+
+  private:
+    const data_type *mData;
+};
+
+
+//
+//	class CDataSource
+//
+//	Basic data provider template class for integral types.
+//	This class can be used to provide the CCompare class with
+//	data from an array of integral types to be compared
+//
+//     const char str[] = "a string to compare";
+//     cmp::CDataSource<const char> compareData1(str, strlen(str));
+//
+
+template<typename T>
+class CDataSource
+{
+  public:
+
+    // public typedef to define the data type
+    typedef T data_type;
+
+  private:
+    const T *mData;         // pointer to the data block
+    const T *mSource;       // pointer to the source data block
+    size_t   mSize;         // length of the data block
+
+  private:
+
+	// prevent compiler autogeneration
+	CDataSource();
+    CDataSource(const CDataSource &);
+	CDataSource &operator=(const CDataSource &);
+
+  public:
+
+    // taking a pointer to the data and the size of the data
+    CDataSource(const T * const data, size_t size) :
+		mData(0),
+		mSource(data),
+		mSize(size)
+	{
+	}
+
+	virtual ~CDataSource() { }
+
+    // all data source classes must define the following interface
+    void clearData() { }
+    
+	bool getAt(size_t index, const data_type **data) const 
+	{
+		*data = &mData[index];
+		return true;
+	}
+
+    const T * const getBaseData() const   { return mData; }
+    const T *getData() const { return mData; }
+    size_t getSize() const { return (mData == 0)? 0 : mSize; }
+
+	// fill the data buffer
+    void retrieveData()
+	{
+		mData = mSource;
+		mSource = 0;
+	}
+};
+
+
+// public typedefs for the record types
+
+enum CRecordType
+{
+    kUndefined=0,
+    kKeep,       // record is in both
+    kRemove,     // record is in the first, but not the second
+    kInsert      // record is in the second, but not the first
+};
+
+
+//
+//	struct CEditRun
+//
+//	Describes a run of consecutive records of the same type. For kKeep and
+//	kRemove runs mStart indexes the first data source, for kInsert runs
+//	it indexes the second one
+//
+
+struct CEditRun
+{
+    CRecordType mType;      // record type (see enum above)
+    size_t      mStart;     // index of the first record of the run
+    size_t      mLength;    // number of records in the run
+
+    CEditRun(CRecordType type, size_t start, size_t length)
+      : mType(type),
+        mStart(start),
+        mLength(length)
+    {
+    }
+
+    size_t getEnd() const { return mStart + mLength; }
+};
+
+
+//
+//	class CEditScript
+//
+//	Compact run-length edit script, allocates O(number of hunks) runs
+//	instead of a record per line. Within each block of changes between
+//	kept records the removals always precede the insertions, so every
+//	hunk costs at most three runs
+//
+
+class CEditScript
+{
+  public:
+
+    typedef std::vector<CEditRun>::const_iterator const_iterator;
+    typedef const_iterator iterator;
+    typedef CEditRun value_type;
+
+  private:
+    std::vector<CEditRun> mRuns;
+
+  public:
+
+    CEditScript() { }
+
+    void clear() { mRuns.clear(); }
+
+    // append single record, merging it into the adjacent run if possible
+    void append(CRecordType type, size_t index) { append(type, index, 1); }
+
+    // append runs of another script
+    void append(const CEditScript &script)
+    {
+        for (const CEditRun &run : script.mRuns)
+        {
+            append(run.mType, run.mStart, run.mLength);
+        }
+    }
+
+    // append run of records
+    void append(CRecordType type, size_t start, size_t length)
+    {
+        if (length == 0)
+        {
+            return;
+        }
+
+        if (type == kRemove  &&  ! mRuns.empty ()  &&  mRuns.back().mType == kInsert)
+        {
+            // keep removals in front of the insertions of the same block
+
+            size_t last = mRuns.size() - 1;
+
+            if (last > 0  &&  mRuns[last - 1].mType == kRemove  &&
+                mRuns[last - 1].getEnd() == start)
+            {
+                mRuns[last - 1].mLength += length;
+            }
+            else
+            {
+                mRuns.insert(mRuns.begin() + last, CEditRun(type, start, length));
+            }
+            return;
+        }
+
+        if (! mRuns.empty()  &&  mRuns.back().mType == type  &&
+            mRuns.back().getEnd() == start)
+        {
+            mRuns.back().mLength += length;
+        }
+        else
+        {
+            mRuns.push_back(CEditRun(type, start, length));
+        }
+    }
+
+    const_iterator begin() const { return mRuns.begin(); }
+    const_iterator end() const { return mRuns.end(); }
+
+    bool empty() const { return mRuns.empty(); }
+
+    // number of runs
+    size_t size() const { return mRuns.size(); }
+
+    // number of records of the given type
+    size_t getCount(CRecordType type) const
+    {
+        size_t count = 0;
+
+        for (const CEditRun &run : mRuns)
+        {
+            if (run.mType == type)
+            {
+                count += run.mLength;
+            }
+        }
+
+        return count;
+    }
+
+    // true if script contains nothing but kept records
+    bool isIdentity() const
+    {
+        for (const CEditRun &run : mRuns)
+        {
+            if (run.mType != kKeep)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+
+//
+//	class CTableMemory
+//
+//	Uninitialised block for lcs tables. Cache line aligned, blocks of huge
+//	page size and more are aligned to it, so the kernel may back them by
+//	huge pages
+//
+
+class CTableMemory
+{
+  public:
+
+    static const size_t kCacheLine = 64;
+    static const size_t kHugePage = 2 * 1024 * 1024;
+
+    explicit CTableMemory(size_t bytes) : mData(NULL)
+    {
+        size_t alignment = (bytes >= kHugePage) ? kHugePage : kCacheLine;
+
+#ifdef _WIN32
+        mData = _aligned_malloc(std::max(bytes, size_t(1)), alignment);
+#else
+        if (posix_memalign(&mData, alignment, std::max(bytes, size_t(1))) != 0)
+        {
+            mData = NULL;
+        }
+#endif
+        THROW_IF (mData == NULL, XNotEnoughMemory);
+
+#if defined(MADV_HUGEPAGE)
+        if (bytes >= kHugePage)
+        {
+            madvise(mData, bytes - bytes % kHugePage, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    ~CTableMemory()
+    {
+#ifdef _WIN32
+        _aligned_free(mData);
+#else
+        free(mData);
+#endif
+    }
+
+    void *get() const { return mData; }
+
+  private:
+
+	// prevent compiler autogeneration
+	CTableMemory();
+    CTableMemory(const CTableMemory &);
+	CTableMemory &operator=(const CTableMemory &);
+
+    void *mData;
+};
+
+
+// diff strategies, from the fastest to the leanest one
+
+enum CStrategy
+{
+    kStrategyFull=0,    // whole lcs matrix
+    kStrategyAnchored,  // split at records unique in both sources, gaps are diffed separately
+    kStrategyBanded,    // lcs matrix restricted to a diagonal band, exact once the band holds the result
+    kStrategyLinear,    // Hirschberg divide and conquer, linear space
+    kStrategyMyers,     // Myers O(ND) within the cost and time limits
+    kStrategyGreedy     // windowed greedy matching once the limits are hit, not minimal
+};
+
+inline const char *getStrategyName(CStrategy strategy)
+{
+    static const char * const names[] = { "full", "anchored", "banded", "linear", "myers", "greedy" };
+    return names[strategy];
+}
+
+
+// default working memory budget of the comparison, bytes
+
+const size_t kDefaultMaxMemory = size_t(1) << 30;
+
+
+//
+//	class CCompare
+//
+//	Primary class that does all the work. The whole lcs matrix is used
+//	while it is small enough and fits the memory budget, otherwise both
+//	sources are split at anchors and each gap is diffed with the fastest
+//	exact strategy that fits the budget, gaps go to the thread pool if any
+//
+
+template<typename T, typename E = CEqualTo<typename T::data_type> >
+class CCompare
+{
+  public:
+
+    // define a typedef for the results
+    typedef CEditScript CResultSet;
+
+    typedef typename T::data_type data_type;
+
+  private:
+    T      *mSource;   // first data source
+    T      *mDest;     // second data source
+
+    CSourceAccess<T> mSourceAccess;     // bound by process()
+    CSourceAccess<T> mDestAccess;
+    E         mEqual;       // records equality predicate
+
+    size_t    mMaxMemory;   // working memory budget, bytes
+    CThreadPool *mPool;     // diffs gaps between anchors, not owned
+    CStrategy mStrategy;    // strategy taken by the last process()
+    size_t    mAnchors;     // anchors found by the last process()
+
+    size_t    mMaxCost;     // edit distance explored before giving up, 0 if unlimited
+    unsigned  mTimeLimit;   // milliseconds spent before giving up, 0 if unlimited
+    size_t    mEdits;       // removed and inserted records of the last process()
+    size_t    mMinEdits;    // lower bound of the minimal number of edits
+
+    CResultSet mStream;     // runs computed but not yet taken by next()
+    size_t    mStreamNext;  // next run of mStream to yield
+
+    std::vector<std::pair<size_t, size_t> > mAnchorList;
+    std::vector<size_t> mTaskBounds;    // first gap of every anchored task
+    size_t    mTaskBudget;  // bytes per task running at once
+    size_t    mNextTask;    // first anchored task not computed yet
+
+    // bigger matrices are split at anchors even if they fit the budget
+    static const size_t kAnchorCells = 16 * 1024 * 1024;
+
+    // approximate cost of the anchor index per record, bytes
+    static const size_t kAnchorBytesPerRecord = 64;
+
+    // columns of a table strip are sized so that their records and two
+    // rows of cells stay in L2 while the strip is filled bottom to top
+    static const size_t kTileBytes = 256 * 1024;
+
+    // traceback directions of a table cell, 2 bits each
+    enum EDirection { kDirInsert = 0, kDirRemove = 1, kDirKeep = 2 };
+    static const size_t kDirsPerByte = 4;
+
+    // initial half width of the band, doubled till the result is exact
+    static const size_t kInitialBand = 32;
+
+    // subproblems this small are finished by the full matrix in linear mode
+    static const size_t kLinearBaseCells = 64 * 1024;
+
+    // greedy matching looks this far ahead in both sources
+    static const size_t kGreedyWindow = 64;
+
+  private:
+
+	// prevent compiler autogeneration
+	CCompare();
+    CCompare(const CCompare &);
+	CCompare &operator=(const CCompare &);
+
+  protected:
+    // bytes of a score cell, 16 bits while any lcs of the ranges fits
+    static size_t getCellSize(size_t n, size_t m)
+		{ return (std::min(n, m) < 0xFFFF) ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+    // bytes of a row of the direction matrix, 2 bits per cell
+    static size_t getTableStride(size_t m)
+		{ return (m + kDirsPerByte - 1) / kDirsPerByte; }
+
+    static bool fitsTable(size_t n, size_t m, size_t budget);
+
+    template<typename C>
+    void  fillTable(size_t col0, size_t col1, size_t row0, size_t row1, uint8_t *dirs) const;
+    void  traceTable(size_t col0, size_t col1, size_t row0, size_t row1, const uint8_t *dirs, CResultSet *pseq) const;
+
+    bool  isEqualAt(size_t col, size_t row) const
+        { return mEqual(mSourceAccess.at(col), mDestAccess.at(row)); }
+
+    // record pointers for the hot loops, a row of the first source
+    // is compared with a run of the second one
+
+    const data_type *sourceAt(size_t col) const { return mSourceAccess.at(col); }
+    const data_type *destAt(size_t row) const { return mDestAccess.at(row); }
+
+    uint64_t hashAt(const T *source, size_t index) const;
+
+    // budgeted strategies, ranges are [col0, col1) of the first source
+    // and [row0, row1) of the second one
+
+    bool  prepareAnchored(CResultSet *pseq);
+    void  processTasks(size_t first, size_t last, CResultSet *pseq) const;
+    size_t getTaskCount() const { return mTaskBounds.empty() ? 0 : mTaskBounds.size() - 1; }
+
+    // gap g goes in front of anchor g, the last gap follows the last anchor
+    void  getGap(size_t g, size_t &col0, size_t &col1, size_t &row0, size_t &row1) const
+    {
+        col0 = (g == 0) ? 0 : mAnchorList[g - 1].first + 1;
+        row0 = (g == 0) ? 0 : mAnchorList[g - 1].second + 1;
+        col1 = (g == mAnchorList.size()) ? mSource->getSize() : mAnchorList[g].first;
+        row1 = (g == mAnchorList.size()) ? mDest->getSize() : mAnchorList[g].second;
+    }
+    int   processBounded(CResultSet *pseq);
+    void  findAnchors(std::vector<std::pair<size_t, size_t> > &anchors) const;
+
+    size_t stripCommon(size_t &col0, size_t &col1, size_t &row0, size_t &row1, CResultSet *pseq) const;
+
+    CStrategy processRange(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, size_t budget) const;
+    void  processFull(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, bool timed = false) const;
+    bool  processBanded(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, size_t budget) const;
+    void  processLinear(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq) const;
+    bool  processMyers(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, size_t &explored) const;
+    void  processGreedy(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq) const;
+
+  public:
+
+    CCompare(T *source, T *dest);
+    ~CCompare();
+
+    int  process(CResultSet *pseq);
+
+    // pull-based alternative to process(), start() loads the sources and
+    // returns false if both are empty, next() yields the runs of the script
+    // in order. gaps between anchors are diffed on demand, a batch keeping
+    // the pool busy at a time, so the first runs come before the last ones
+    // are computed
+    bool start();
+    bool next(CEditRun &run);
+
+    void   setMaxMemory(size_t bytes) { mMaxMemory = bytes; }
+    size_t getMaxMemory() const { return mMaxMemory; }
+
+    void   setThreadPool(CThreadPool *pool) { mPool = pool; }
+
+    CStrategy getStrategy() const { return mStrategy; }
+    size_t getAnchorCount() const { return mAnchors; }
+
+    // latency knobs, past either limit the result is no longer minimal
+    void   setMaxCost(size_t cost) { mMaxCost = cost; }
+    void   setTimeLimit(unsigned milliseconds) { mTimeLimit = milliseconds; }
+
+    // quality of the last result of the limited mode
+    size_t getEditCount() const { return mEdits; }
+    size_t getMinEditCount() const { return mMinEdits; }
+};
+
+
+// just stores the data pointers
+
+template<typename T, typename E>
+CCompare<T, E>::CCompare(T *source, T *dest)
+  : mSource(source),
+    mDest(dest),
+    mMaxMemory(kDefaultMaxMemory),
+    mPool(NULL),
+    mStrategy(kStrategyFull),
+    mAnchors(0),
+    mMaxCost(0),
+    mTimeLimit(0),
+    mEdits(0),
+    mMinEdits(0),
+    mStreamNext(0),
+    mTaskBudget(0),
+    mNextTask(0)
+{
+}
+
+
+// nothing owned
+
+template<typename T, typename E>
+CCompare<T, E>::~CCompare()
+{
+}
+
+
+// this is the main function
+// we calculate the whole script and return the lcs length
+
+template<typename T, typename E>
+int CCompare<T, E>::process(CResultSet *pseq)
+{
+    size_t kept = pseq->getCount(kKeep);
+
+    if (! this->start())
+    {
+        return -1;
+    }
+
+    // all the anchored tasks at once balance the pool best
+
+    pseq->append(mStream);
+    mStream.clear();
+
+    this->processTasks(mNextTask, this->getTaskCount(), pseq);
+    mNextTask = this->getTaskCount();
+
+    return int(pseq->getCount(kKeep) - kept);
+}
+
+
+// load the sources and pick the strategy. anchored diffs are left to
+// next(), the others are computed at once
+
+template<typename T, typename E>
+bool CCompare<T, E>::start()
+{
+    mStream.clear();
+    mStreamNext = 0;
+    mAnchorList.clear();
+    mTaskBounds.clear();
+    mNextTask = 0;
+
+    // load both data sources concurrently, the second one goes to
+    // a worker thread, its exceptions are rethrown by get ()
+
+    std::future<void> destLoad = std::async(std::launch::async, [this]()
+    {
+        mDest->clearData();
+        mDest->retrieveData();
+    });
+
+    mSource->clearData();
+    mSource->retrieveData();
+
+    destLoad.get();
+
+    mSourceAccess.bind(mSource);
+    mDestAccess.bind(mDest);
+
+    // if we're at the end of both data streams,
+    // then return false to indicate the end
+
+    if (mSource->getSize () == 0  &&  mDest->getSize () == 0)
+    {
+        return false;
+    }
+
+    // if the two data sources are equal size, then try
+    // a quick memcmp first. this avoids unnecessary
+    // processing using the slower lcs algorithm. only
+    // integral records may be compared as bytes
+
+    const void * const baseData1 = mSource->getBaseData ();
+    const void * const baseData2 = mDest->getBaseData ();
+
+    if (std::is_integral<data_type>::value
+        &&  baseData1 != NULL  &&  baseData2 != NULL
+	    &&  mSource->getSize() == mDest->getSize()
+		&&  memcmp(baseData1, baseData2, mSource->getSize() * sizeof(data_type)) == 0)
+    {
+		LOG_LINE ("Identical sources");
+        mStream.append(kKeep, 0, mSource->getSize());
+        return true;
+    }
+
+    mStrategy = kStrategyFull;
+    mAnchors = 0;
+    mEdits = 0;
+    mMinEdits = 0;
+
+    if (mMaxCost != 0  ||  mTimeLimit != 0)
+    {
+        this->processBounded(&mStream);
+        return true;
+    }
+
+    // the whole matrix is used while it is small enough and fits
+    // the budget, otherwise split at anchors
+
+    size_t ncols = mSource->getSize();
+    size_t nrows = mDest->getSize();
+
+    if (! fitsTable(ncols, nrows, mMaxMemory)  ||
+        1 + ncols > kAnchorCells / (1 + nrows))
+    {
+        this->prepareAnchored(&mStream);
+        return true;
+    }
+
+    LOG_LINE("Compare< " << typeid(T).name() << "> processing type \'" <<
+        typeid(typename T::data_type).name() << "\'");
+
+    this->processFull(0, ncols, 0, nrows, &mStream, true);
+
+    return true;
+}
+
+
+template<typename T, typename E>
+bool CCompare<T, E>::next(CEditRun &run)
+{
+    while (mStreamNext == mStream.size())
+    {
+        if (mNextTask == this->getTaskCount())
+        {
+            return false;
+        }
+
+        // every task ends with an anchor, so runs never straddle batches
+
+        size_t workers = (mPool != NULL) ? mPool->getSize() + 1 : 1;
+        size_t last = std::min(mNextTask + workers, this->getTaskCount());
+
+        mStream.clear();
+        mStreamNext = 0;
+
+        this->processTasks(mNextTask, last, &mStream);
+        mNextTask = last;
+    }
+
+    run = *(mStream.begin() + mStreamNext++);
+
+    return true;
+}
+
+
+// hash of a record, anchors are found by them
+
+template<typename T, typename E>
+uint64_t CCompare<T, E>::hashAt(const T *source, size_t index) const
+{
+    return hashOf((source == mSource) ? mSourceAccess.at(index) : mDestAccess.at(index));
+}
+
+
+// diff sources whose whole matrix is too big: gaps between anchors are
+// independent, adjacent gaps are grouped into tasks of similar cost which
+// run on the thread pool sharing the budget, their scripts are concatenated.
+// Without anchors the sources are diffed at once, false is returned then
+
+template<typename T, typename E>
+bool CCompare<T, E>::prepareAnchored(CResultSet *pseq)
+{
+    STATS_PHASE (kPhaseLcs);
+
+    size_t ncols = mSource->getSize();
+    size_t nrows = mDest->getSize();
+
+    std::vector<std::pair<size_t, size_t> > &anchors = mAnchorList;
+
+    if ((ncols + nrows) <= mMaxMemory / kAnchorBytesPerRecord)
+    {
+        this->findAnchors(anchors);
+    }
+
+    mAnchors = anchors.size();
+
+    if (anchors.empty())
+    {
+        mStrategy = this->processRange(0, ncols, 0, nrows, pseq, mMaxMemory);
+
+        return false;
+    }
+
+    mStrategy = kStrategyAnchored;
+
+    size_t gaps = anchors.size() + 1;
+    size_t workers = (mPool != NULL) ? mPool->getSize() + 1 : 1;
+
+    std::vector<uint64_t> costs(gaps);
+    uint64_t total = 0;
+
+    for (size_t g = 0; g < gaps; g++)
+    {
+        size_t col0, col1, row0, row1;
+        this->getGap(g, col0, col1, row0, row1);
+
+        costs[g] = uint64_t(col1 - col0 + 1) * (row1 - row0 + 1);
+        total += costs[g];
+    }
+
+    // first gap of every task
+
+    std::vector<size_t> &bounds = mTaskBounds;
+    uint64_t target = total / (4 * workers) + 1;
+    uint64_t sum = 0;
+
+    bounds.assign(1, 0);
+
+    for (size_t g = 0; g + 1 < gaps; g++)
+    {
+        if ((sum += costs[g]) >= target)
+        {
+            bounds.push_back(g + 1);
+            sum = 0;
+        }
+    }
+
+    bounds.push_back(gaps);
+
+    mTaskBudget = mMaxMemory / std::min(workers, this->getTaskCount());
+
+    return true;
+}
+
+
+// tasks [first, last) of the anchored diff, their scripts are appended in order
+
+template<typename T, typename E>
+void CCompare<T, E>::processTasks(size_t first, size_t last, CResultSet *pseq) const
+{
+    if (first >= last)
+    {
+        return;
+    }
+
+    STATS_PHASE (kPhaseLcs);
+
+    const std::vector<std::pair<size_t, size_t> > &anchors = mAnchorList;
+    const std::vector<size_t> &bounds = mTaskBounds;
+
+    std::vector<CResultSet> scripts(last - first);
+
+    std::function<void (size_t)> body = [&](size_t t)
+    {
+        CResultSet &script = scripts[t];
+
+        for (size_t g = bounds[first + t]; g < bounds[first + t + 1]; g++)
+        {
+            size_t col0, col1, row0, row1;
+            this->getGap(g, col0, col1, row0, row1);
+
+            this->processRange(col0, col1, row0, row1, &script, mTaskBudget);
+
+            if (g < anchors.size())
+            {
+                script.append(kKeep, anchors[g].first);
+            }
+        }
+    };
+
+    if (mPool != NULL  &&  scripts.size() > 1)
+    {
+        mPool->parallelFor(scripts.size(), body);
+    }
+    else
+    {
+        for (size_t t = 0; t < scripts.size(); t++)
+        {
+            body(t);
+        }
+    }
+
+    for (const CResultSet &script : scripts)
+    {
+        pseq->append(script);
+    }
+}
+
+
+// anchors are records unique in both sources, the longest chain
+// of them going in the same order in both sources is taken
+
+template<typename T, typename E>
+void CCompare<T, E>::findAnchors(std::vector<std::pair<size_t, size_t> > &anchors) const
+{
+    struct CCount
+    {
+        size_t mCol, mRow;      // last position in each source
+        size_t mCols, mRows;    // occurrences in each source
+    };
+
+    size_t ncols = mSource->getSize();
+    size_t nrows = mDest->getSize();
+
+    std::unordered_map<uint64_t, CCount> counts;
+
+    counts.reserve(ncols);
+
+    for (size_t col = 0; col < ncols; col++)
+    {
+        CCount &count = counts.insert(std::make_pair(this->hashAt(mSource, col), CCount())).first->second;
+
+        count.mCol = col;
+        count.mCols ++;
+    }
+
+    for (size_t row = 0; row < nrows; row++)
+    {
+        typename std::unordered_map<uint64_t, CCount>::iterator it = counts.find(this->hashAt(mDest, row));
+
+        if (it != counts.end())
+        {
+            it->second.mRow = row;
+            it->second.mRows ++;
+        }
+    }
+
+    // unique records in the order of the first source, equal hashes
+    // of different records just lose the anchor
+
+    std::vector<std::pair<size_t, size_t> > unique;
+
+    for (size_t col = 0; col < ncols; col++)
+    {
+        const CCount &count = counts[this->hashAt(mSource, col)];
+
+        if (count.mCols == 1  &&  count.mRows == 1  &&  this->isEqualAt(col, count.mRow))
+        {
+            unique.push_back(std::make_pair(col, count.mRow));
+        }
+    }
+
+    counts.clear();
+
+    // longest increasing chain of second source positions (patience sorting)
+
+    const size_t none = size_t(-1);
+
+    std::vector<size_t> tails;
+    std::vector<size_t> prev(unique.size(), none);
+
+    for (size_t i = 0; i < unique.size(); i++)
+    {
+        size_t lo = 0;
+        size_t hi = tails.size();
+
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+
+            if (unique[tails[mid]].second < unique[i].second)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        prev[i] = (lo > 0) ? tails[lo - 1] : none;
+
+        if (lo == tails.size())
+            tails.push_back(i);
+        else
+            tails[lo] = i;
+    }
+
+    anchors.clear();
+
+    for (size_t i = tails.empty() ? none : tails.back(); i != none; i = prev[i])
+    {
+        anchors.push_back(unique[i]);
+    }
+
+    std::reverse(anchors.begin(), anchors.end());
+}
+
+
+// common prefix and suffix are kept in any case, the prefix is appended
+// at once, the suffix length is returned. Ranges are narrowed to the rest
+
+template<typename T, typename E>
+size_t CCompare<T, E>::stripCommon(size_t &col0, size_t &col1, size_t &row0, size_t &row1, CResultSet *pseq) const
+{
+    size_t prefix = 0;
+
+    while (col0 + prefix < col1  &&  row0 + prefix < row1  &&  this->isEqualAt(col0 + prefix, row0 + prefix))
+    {
+        prefix ++;
+    }
+
+    pseq->append(kKeep, col0, prefix);
+
+    col0 += prefix;
+    row0 += prefix;
+
+    size_t suffix = 0;
+
+    while (col0 < col1 - suffix  &&  row0 < row1 - suffix  &&  this->isEqualAt(col1 - suffix - 1, row1 - suffix - 1))
+    {
+        suffix ++;
+    }
+
+    col1 -= suffix;
+    row1 -= suffix;
+
+    return suffix;
+}
+
+
+// diff the ranges with the fastest exact strategy fitting the budget, bytes
+
+template<typename T, typename E>
+CStrategy CCompare<T, E>::processRange(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, size_t budget) const
+{
+    size_t suffix = this->stripCommon(col0, col1, row0, row1, pseq);
+
+    CStrategy strategy = kStrategyFull;
+
+    if (col0 == col1  ||  row0 == row1)
+    {
+        pseq->append(kRemove, col0, col1 - col0);
+        pseq->append(kInsert, row0, row1 - row0);
+    }
+    else if (fitsTable(col1 - col0, row1 - row0, budget))
+    {
+        this->processFull(col0, col1, row0, row1, pseq);
+    }
+    else if (this->processBanded(col0, col1, row0, row1, pseq, budget))
+    {
+        strategy = kStrategyBanded;
+    }
+    else
+    {
+        this->processLinear(col0, col1, row0, row1, pseq);
+        strategy = kStrategyLinear;
+    }
+
+    pseq->append(kKeep, col1, suffix);
+
+    return strategy;
+}
+
+
+// whole matrix of the ranges. scores of cell (i, j), the lcs length of
+// the range suffixes starting at col0 + i and row0 + j, are kept for the
+// rows being filled only, the traceback needs just the direction taken
+// from every cell
+
+template<typename T, typename E>
+bool CCompare<T, E>::fitsTable(size_t n, size_t m, size_t budget)
+{
+    // the directions, a column and two rows of scores
+    size_t scores = (n + 2 * m + 4) * sizeof(uint32_t);
+
+    return scores < budget  &&  n <= (budget - scores) / std::max(getTableStride(m), size_t(1));
+}
+
+
+template<typename T, typename E>
+void CCompare<T, E>::processFull(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, bool timed) const
+{
+    size_t n = col1 - col0;
+    size_t m = row1 - row0;
+
+    size_t bytes = n * getTableStride(m);
+
+    LOG_LINE("Allocating " << bytes << " bytes");
+
+    CTableMemory memory(bytes);
+    uint8_t *dirs = static_cast<uint8_t *>(memory.get());
+
+    memset(dirs, 0, bytes);
+
+    // timed tables account the fill to the lcs phase and the traceback to
+    // the script one, tables of gaps are accounted by their caller
+
+    {
+        std::unique_ptr<CStatsPhase> phase(timed ? new CStatsPhase(CStats::kPhaseLcs) : NULL);
+
+        if (getCellSize(n, m) == sizeof(uint16_t))
+        {
+            this->fillTable<uint16_t>(col0, col1, row0, row1, dirs);
+        }
+        else
+        {
+            this->fillTable<uint32_t>(col0, col1, row0, row1, dirs);
+        }
+    }
+
+    std::unique_ptr<CStatsPhase> phase(timed ? new CStatsPhase(CStats::kPhaseScript) : NULL);
+
+    this->traceTable(col0, col1, row0, row1, dirs, pseq);
+}
+
+
+// rows are the records of the first range, each is filled right to left
+// from the row below. the columns are split into strips fitting L2, which
+// are filled right to left, every strip bottom to top, so the records of
+// the second range are fetched from memory once per strip, not per row.
+// edge keeps the leftmost scores of the strip on the right
+
+template<typename T, typename E>
+template<typename C>
+void CCompare<T, E>::fillTable(size_t col0, size_t col1, size_t row0, size_t row1, uint8_t *dirs) const
+{
+    size_t n = col1 - col0;
+    size_t m = row1 - row0;
+    size_t stride = getTableStride(m);
+
+    STATS_COUNT (kCellsEvaluated, (n + 1) * (m + 1));
+
+    size_t strip = std::max(size_t(64), kTileBytes / (sizeof(data_type) + 2 * sizeof(C)));
+
+    // the lcs past the end of either range is empty
+
+    std::vector<C> edge(n, 0);
+    std::vector<C> rows(2 * (std::min(strip, m) + 1));
+
+    for (size_t end = m; end > 0; )
+    {
+        size_t begin = (end > strip) ? end - strip : 0;
+        size_t width = end - begin;
+
+        C *cur = &rows[0];
+        C *below = cur + width + 1;
+
+        std::fill(below, below + width + 1, C(0));
+
+        for (size_t i = n; i-- > 0; )
+        {
+            const data_type *data1 = this->sourceAt(col0 + i);
+            uint8_t *dir = dirs + i * stride;
+
+            cur[width] = edge[i];
+
+            for (size_t k = width; k-- > 0; )
+            {
+                size_t j = begin + k;
+                unsigned code;
+
+                if (mEqual(data1, this->destAt(row0 + j)))
+                {
+                    cur[k] = C(below[k + 1] + 1);
+                    code = kDirKeep;
+                }
+                else if (below[k] > cur[k + 1])
+                {
+                    cur[k] = below[k];
+                    code = kDirRemove;
+                }
+                else
+                {
+                    cur[k] = cur[k + 1];
+                    code = kDirInsert;
+                }
+
+                dir[j / kDirsPerByte] |= uint8_t(code << (2 * (j % kDirsPerByte)));
+            }
+
+            edge[i] = cur[0];
+            std::swap(cur, below);
+        }
+
+        end = begin;
+    }
+}
+
+
+template<typename T, typename E>
+void CCompare<T, E>::traceTable(size_t col0, size_t col1, size_t row0, size_t row1, const uint8_t *dirs, CResultSet *pseq) const
+{
+    size_t n = col1 - col0;
+    size_t m = row1 - row0;
+    size_t stride = getTableStride(m);
+
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < n  &&  j < m)
+    {
+        switch ((dirs[i * stride + j / kDirsPerByte] >> (2 * (j % kDirsPerByte))) & 3)
+        {
+        case kDirKeep:
+            pseq->append(kKeep, col0 + i);
+            i ++;
+            j ++;
+            break;
+
+        case kDirRemove:
+            pseq->append(kRemove, col0 + i);
+            i ++;
+            break;
+
+        default:
+            pseq->append(kInsert, row0 + j);
+            j ++;
+            break;
+        }
+    }
+
+    // past the end of either range the rest of the other one is edited
+
+    pseq->append(kRemove, col0 + i, n - i);
+    pseq->append(kInsert, row0 + j, m - j);
+}
+
+
+// Ukkonen's band: only diagonals d = j - i within [lo, hi] are evaluated.
+// Any edit path leaving the band has more than skew + 2k edits, so the
+// band result is exact once it has no more than that, otherwise the band
+// is doubled till it does not fit the budget. false when no exact result
+
+template<typename T, typename E>
+bool CCompare<T, E>::processBanded(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, size_t budget) const
+{
+    ptrdiff_t n = ptrdiff_t(col1 - col0);
+    ptrdiff_t m = ptrdiff_t(row1 - row0);
+    size_t skew = size_t((n > m) ? n - m : m - n);
+
+    size_t cells = budget / sizeof(uint32_t) / size_t(n + 1);
+
+    if (cells < skew + 3)
+    {
+        return false;
+    }
+
+    size_t maxBand = (cells - skew - 1) / 2;
+
+    std::vector<uint32_t> band;
+
+    for (size_t k = std::min(maxBand, size_t(kInitialBand)); ; k = std::min(maxBand, 2 * k))
+    {
+        ptrdiff_t lo = std::min(ptrdiff_t(0), m - n) - ptrdiff_t(k);
+        ptrdiff_t hi = std::max(ptrdiff_t(0), m - n) + ptrdiff_t(k);
+        ptrdiff_t width = hi - lo + 1;
+
+        STATS_COUNT (kCellsEvaluated, size_t(n + 1) * size_t(width));
+
+        band.assign(size_t(n + 1) * size_t(width), 0);
+
+        // cell (i, j) lives at row i, offset j - i - lo
+
+        auto at = [&band, width, lo](ptrdiff_t i, ptrdiff_t j) -> uint32_t &
+        {
+            return band[size_t(i * width + j - i - lo)];
+        };
+
+        for (ptrdiff_t i = n; i >= 0; --i)
+        {
+            ptrdiff_t jmin = std::max(ptrdiff_t(0), i + lo);
+            ptrdiff_t jmax = std::min(m, i + hi);
+            const data_type *data1 = (i < n) ? this->sourceAt(col0 + i) : NULL;
+
+            for (ptrdiff_t j = jmax; j >= jmin; --j)
+            {
+                uint32_t v = 0;
+
+                if (i == n  ||  j == m)
+                {
+                    v = 0;
+                }
+                else if (mEqual(data1, this->destAt(row0 + j)))
+                {
+                    v = at(i + 1, j + 1) + 1;
+                }
+                else
+                {
+                    if (j - i - 1 >= lo)
+                        v = at(i + 1, j);
+
+                    if (j - i + 1 <= hi)
+                        v = std::max(v, at(i, j + 1));
+                }
+
+                at(i, j) = v;
+            }
+        }
+
+        size_t edits = size_t(n + m) - 2 * size_t(at(0, 0));
+
+        if (edits <= skew + 2 * k  ||  (lo <= -n  &&  hi >= m))
+        {
+            ptrdiff_t i = 0;
+            ptrdiff_t j = 0;
+
+            while (i < n  ||  j < m)
+            {
+                ptrdiff_t d = j - i;
+
+                if (i < n  &&  j < m  &&  this->isEqualAt(col0 + i, row0 + j))
+                {
+                    pseq->append(kKeep, col0 + i);
+                    i ++;
+                    j ++;
+                }
+                else if (i < n  &&  (j == m  ||  (d - 1 >= lo  &&
+                    (d + 1 > hi  ||  at(i + 1, j) > at(i, j + 1)))))
+                {
+                    pseq->append(kRemove, col0 + i);
+                    i ++;
+                }
+                else
+                {
+                    pseq->append(kInsert, row0 + j);
+                    j ++;
+                }
+            }
+
+            return true;
+        }
+
+        if (k == maxBand)
+        {
+            return false;
+        }
+    }
+}
+
+
+// Hirschberg: lcs rows of the upper half forwards and of the lower half
+// backwards give the optimal split of the second range, both halves are
+// solved recursively. Memory is linear, time is about twice the full one
+
+template<typename T, typename E>
+void CCompare<T, E>::processLinear(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq) const
+{
+    size_t n = col1 - col0;
+    size_t m = row1 - row0;
+
+    if (n == 0  ||  m == 0)
+    {
+        pseq->append(kRemove, col0, n);
+        pseq->append(kInsert, row0, m);
+        return;
+    }
+
+    if (n < 2  ||  (n + 1) * (m + 1) <= kLinearBaseCells)
+    {
+        this->processFull(col0, col1, row0, row1, pseq);
+        return;
+    }
+
+    STATS_COUNT (kCellsEvaluated, n * m);
+
+    size_t mid = n / 2;
+
+    // forward[j]: lcs of [col0, col0 + mid) and [row0, row0 + j)
+
+    std::vector<uint32_t> forward(m + 1, 0);
+
+    for (size_t i = 0; i < mid; i++)
+    {
+        uint32_t diag = 0;
+        const data_type *data1 = this->sourceAt(col0 + i);
+
+        for (size_t j = 1; j <= m; j++)
+        {
+            uint32_t up = forward[j];
+
+            forward[j] = mEqual(data1, this->destAt(row0 + j - 1)) ?
+                diag + 1 : std::max(up, forward[j - 1]);
+
+            diag = up;
+        }
+    }
+
+    // backward[j]: lcs of [col0 + mid, col1) and [row0 + j, row1)
+
+    std::vector<uint32_t> backward(m + 1, 0);
+
+    for (size_t i = n; i-- > mid; )
+    {
+        uint32_t diag = 0;
+        const data_type *data1 = this->sourceAt(col0 + i);
+
+        for (size_t j = m; j-- > 0; )
+        {
+            uint32_t up = backward[j];
+
+            backward[j] = mEqual(data1, this->destAt(row0 + j)) ?
+                diag + 1 : std::max(up, backward[j + 1]);
+
+            diag = up;
+        }
+    }
+
+    size_t split = 0;
+
+    for (size_t j = 1; j <= m; j++)
+    {
+        if (forward[j] + backward[j] > forward[split] + backward[split])
+        {
+            split = j;
+        }
+    }
+
+    forward.clear();
+    forward.shrink_to_fit();
+    backward.clear();
+    backward.shrink_to_fit();
+
+    this->processLinear(col0, col0 + mid, row0, row0 + split, pseq);
+    this->processLinear(col0 + mid, col1, row0 + split, row1, pseq);
+}
+
+
+// latency bounded mode: Myers till the cost or time limit, then greedy
+
+template<typename T, typename E>
+int CCompare<T, E>::processBounded(CResultSet *pseq)
+{
+    STATS_PHASE (kPhaseLcs);
+
+    size_t col0 = 0, col1 = mSource->getSize();
+    size_t row0 = 0, row1 = mDest->getSize();
+    size_t kept = pseq->getCount(kKeep);
+    size_t explored = 0;
+
+    size_t suffix = this->stripCommon(col0, col1, row0, row1, pseq);
+
+    size_t n = col1 - col0;
+    size_t m = row1 - row0;
+
+    if (this->processMyers(col0, col1, row0, row1, pseq, explored))
+    {
+        mStrategy = kStrategyMyers;
+        mMinEdits = explored;
+    }
+    else
+    {
+        // nothing cheaper than the explored cost exists, and at least
+        // the size difference has to be edited
+
+        mStrategy = kStrategyGreedy;
+        mMinEdits = std::max(explored + 1, (n > m) ? n - m : m - n);
+
+        this->processGreedy(col0, col1, row0, row1, pseq);
+    }
+
+    pseq->append(kKeep, col1, suffix);
+
+    size_t lcs = pseq->getCount(kKeep) - kept;
+
+    mEdits = (mSource->getSize() - lcs) + (mDest->getSize() - lcs);
+    mMinEdits = std::min(mMinEdits, mEdits);
+
+    return int(lcs);
+}
+
+
+// Myers: furthest reaching paths for growing edit distance d, the path
+// of every d is kept for the traceback. Gives up past the cost limit,
+// the time limit or the memory budget, explored is the last d tried
+
+template<typename T, typename E>
+bool CCompare<T, E>::processMyers(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq, size_t &explored) const
+{
+    typedef std::chrono::steady_clock CClock;
+
+    ptrdiff_t n = ptrdiff_t(col1 - col0);
+    ptrdiff_t m = ptrdiff_t(row1 - row0);
+
+    // history of d keeps d + 1 diagonals, (d + 1) (d + 2) / 2 in total
+
+    size_t maxCost = size_t(n + m);
+
+    if (mMaxCost != 0)
+    {
+        maxCost = std::min(maxCost, mMaxCost);
+    }
+
+    while (maxCost > 0  &&  (maxCost + 1) * (maxCost + 2) / 2 > mMaxMemory / sizeof(ptrdiff_t))
+    {
+        maxCost /= 2;
+    }
+
+    CClock::time_point deadline = CClock::now() + std::chrono::milliseconds(mTimeLimit);
+
+    std::vector<ptrdiff_t> history;
+
+    // x of diagonal k = x - y after step d
+
+    auto at = [&history](ptrdiff_t d, ptrdiff_t k) -> ptrdiff_t &
+    {
+        return history[size_t(d * (d + 1) / 2 + (k + d) / 2)];
+    };
+
+    explored = 0;
+
+    ptrdiff_t found = -1;
+
+    for (ptrdiff_t d = 0; d <= ptrdiff_t(maxCost)  &&  found < 0; d++)
+    {
+        if (mTimeLimit != 0  &&  CClock::now() > deadline)
+        {
+            return false;
+        }
+
+        explored = size_t(d);
+        history.resize(size_t((d + 1) * (d + 2) / 2));
+
+        for (ptrdiff_t k = -d; k <= d; k += 2)
+        {
+            ptrdiff_t x;
+
+            if (d == 0)
+                x = 0;
+            else if (k == -d  ||  (k != d  &&  at(d - 1, k - 1) < at(d - 1, k + 1)))
+                x = at(d - 1, k + 1);       // insertion
+            else
+                x = at(d - 1, k - 1) + 1;   // removal
+
+            ptrdiff_t y = x - k;
+
+            while (x < n  &&  y < m  &&  this->isEqualAt(col0 + x, row0 + y))
+            {
+                x ++;
+                y ++;
+            }
+
+            at(d, k) = x;
+
+            if (x >= n  &&  y >= m)
+            {
+                found = d;
+                break;
+            }
+        }
+
+        STATS_COUNT (kCellsEvaluated, size_t(d + 1));
+    }
+
+    if (found < 0)
+    {
+        return false;
+    }
+
+    // walk back from the end, collecting runs in reverse order
+
+    std::vector<CEditRun> runs;
+
+    ptrdiff_t x = n;
+    ptrdiff_t y = m;
+
+    for (ptrdiff_t d = found; d > 0; d--)
+    {
+        ptrdiff_t k = x - y;
+        bool down = (k == -d  ||  (k != d  &&  at(d - 1, k - 1) < at(d - 1, k + 1)));
+
+        ptrdiff_t kPrev = down ? k + 1 : k - 1;
+        ptrdiff_t xStart = at(d - 1, kPrev);
+        ptrdiff_t yStart = xStart - kPrev;
+        ptrdiff_t xMid = down ? xStart : xStart + 1;
+
+        runs.push_back(CEditRun(kKeep, col0 + size_t(xMid), size_t(x - xMid)));
+
+        if (down)
+            runs.push_back(CEditRun(kInsert, row0 + size_t(yStart), 1));
+        else
+            runs.push_back(CEditRun(kRemove, col0 + size_t(xStart), 1));
+
+        x = xStart;
+        y = yStart;
+    }
+
+    runs.push_back(CEditRun(kKeep, col0, size_t(x)));
+
+    for (size_t i = runs.size(); i-- > 0; )
+    {
+        pseq->append(runs[i].mType, runs[i].mStart, runs[i].mLength);
+    }
+
+    return true;
+}
+
+
+// greedy alignment: on a mismatch take the nearest pair of equal records
+// within the window ahead of both positions, positions of every record of
+// the second range are indexed by hash to find them quickly
+
+template<typename T, typename E>
+void CCompare<T, E>::processGreedy(size_t col0, size_t col1, size_t row0, size_t row1, CResultSet *pseq) const
+{
+    std::unordered_map<uint64_t, std::vector<size_t> > positions;
+
+    for (size_t row = row0; row < row1; row++)
+    {
+        positions[this->hashAt(mDest, row)].push_back(row);
+    }
+
+    size_t col = col0;
+    size_t row = row0;
+
+    while (col < col1  &&  row < row1)
+    {
+        if (this->isEqualAt(col, row))
+        {
+            pseq->append(kKeep, col);
+            col ++;
+            row ++;
+            continue;
+        }
+
+        // nearest match costs skipCols + skipRows
+
+        size_t bestCol = 0, bestRow = 0;
+        size_t bestCost = size_t(-1);
+
+        for (size_t skip = 0; skip < kGreedyWindow  &&  col + skip < col1  &&  skip < bestCost; skip++)
+        {
+            typename std::unordered_map<uint64_t, std::vector<size_t> >::const_iterator it =
+                positions.find(this->hashAt(mSource, col + skip));
+
+            if (it == positions.end())
+            {
+                continue;
+            }
+
+            std::vector<size_t>::const_iterator pos =
+                std::lower_bound(it->second.begin(), it->second.end(), row);
+
+            for ( ; pos != it->second.end()  &&  *pos - row < kGreedyWindow  &&
+                skip + (*pos - row) < bestCost; ++pos)
+            {
+                if (this->isEqualAt(col + skip, *pos))
+                {
+                    bestCol = col + skip;
+                    bestRow = *pos;
+                    bestCost = skip + (*pos - row);
+                    break;
+                }
+            }
+        }
+
+        if (bestCost == size_t(-1))
+        {
+            // nothing close, replace a single record
+
+            bestCol = col + 1;
+            bestRow = row + 1;
+        }
+
+        pseq->append(kRemove, col, bestCol - col);
+        pseq->append(kInsert, row, bestRow - row);
+
+        col = bestCol;
+        row = bestRow;
+    }
+
+    pseq->append(kRemove, col, col1 - col);
+    pseq->append(kInsert, row, row1 - row);
+}
+
+
+// small test function to calculate the difference
+// between two character strings
+
+inline void testCharacterDiff(const char * const str1, const char * const str2)
+{
+    // instantiate data source objects for each text string
+    cmp::CDataSource<const char> compare_data1(str1, strlen(str1));
+    cmp::CDataSource<const char> compare_data2(str2, strlen(str2));
+
+    // we need to instantiate a template compare object
+    // create a typedef first so that we can use a short-handed
+    // version later
+    typedef cmp::CCompare< cmp::CDataSource<const char> > compare_t;
+    compare_t compare(&compare_data1, &compare_data2);
+
+    size_t                lcs;
+    std::string           result_str1, result_str2;
+    compare_t::CResultSet seq;
+
+    // process the data sources
+    if ((lcs = compare.process(&seq)) != -1)
+    {
+        printf("Comparing: \"%s\" & \"%s\"\n"
+               "Longest Common Subsequence length is %d\n", str1, str2, lcs);
+
+        for (const cmp::CEditRun &run : seq)
+        {
+            for (size_t i = run.mStart; i < run.getEnd(); i++)
+            {
+                if (run.mType == cmp::kRemove)
+                {
+                    result_str1 += str1[i];
+                    result_str2 += '_';
+                }
+                else if (run.mType == cmp::kInsert)
+                {
+                    result_str1 += '_';
+                    result_str2 += str2[i];
+                }
+                else
+                {
+                    result_str1 += str1[i];
+                    result_str2 += str1[i];
+                }
+            }
+        }
+    }
+
+    printf("%s\n%s\n\n", result_str1.c_str(), result_str2.c_str());
+}
+
+}   // namespace cmp
+
+#endif  // __CCompare_h
@@ -0,0 +1,182 @@
+#include "stdafx.h"
+
+#include "CCorpusGenerator.h"
+
+#include <algorithm>
+
+
+//
+//	class CCorpusGenerator
+//
+
+CCorpusGenerator::CCorpusGenerator (const CCorpusParams &inParams) :
+	mParams (inParams),
+	mState (inParams.mSeed),
+	mSerial (0)
+{
+	THROW_IF (mParams.mEditDensity < 0  ||  mParams.mEditDensity > 1, XOutOfRangeValue);
+	THROW_IF (mParams.mDuplicateRatio < 0  ||  mParams.mDuplicateRatio > 1, XOutOfRangeValue);
+	THROW_IF (mParams.mClusterSize == 0, XOutOfRangeValue);
+
+	// Typical repeated lines of a source file
+
+	static const char *const sPool [] =
+	{
+		"", "{", "}", "\t}", "\t{", "\t\treturn;", "\t\tbreak;", "\telse",
+		"#endif", "/*", " */", "\t\t}", "\t\t{", "\treturn 0;", "// ---", "\t\tcontinue;"
+	};
+
+	mPool.assign (sPool, sPool + sizeof (sPool) / sizeof (sPool [0]));
+}
+
+
+CCorpusGenerator::~CCorpusGenerator ()
+{
+}
+
+
+uint64_t
+CCorpusGenerator::next ()
+{
+	uint64_t z = (mState += 0x9e3779b97f4a7c15ull);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+	return z ^ (z >> 31);
+}
+
+
+size_t
+CCorpusGenerator::nextIndex (size_t inRange)
+{
+	return (inRange == 0) ? 0 : (size_t) (next () % inRange);
+}
+
+
+double
+CCorpusGenerator::nextDouble ()
+{
+	return (next () >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// Unique line of about mLineLength characters, or a repeated one
+
+std::string
+CCorpusGenerator::makeLine ()
+{
+	if (nextDouble () < mParams.mDuplicateRatio)
+	{
+		return mPool [nextIndex (mPool.size ())];
+	}
+
+	static const char sAlphabet [] = "abcdefghijklmnopqrstuvwxyz     ();=+";
+
+	std::string line = "l" + std::to_string (mSerial ++) + " ";
+
+	size_t length = mParams.mLineLength / 2 + nextIndex (mParams.mLineLength + 1);
+
+	while (line.size () < length)
+	{
+		line += sAlphabet [nextIndex (sizeof (sAlphabet) - 1)];
+	}
+
+	return line;
+}
+
+
+void
+CCorpusGenerator::join (const std::vector<std::string> &inLines, std::string &outText)
+{
+	outText.clear ();
+
+	for (size_t i = 0; i < inLines.size (); i++)
+	{
+		outText += inLines [i];
+		outText += '\n';
+	}
+}
+
+
+void
+CCorpusGenerator::generate (std::string &outSource, std::string &outDest)
+{
+	std::vector<std::string> source;
+	std::vector<std::string> dest;
+
+	source.reserve (mParams.mLines);
+
+	for (size_t i = 0; i < mParams.mLines; i++)
+	{
+		source.push_back (makeLine ());
+	}
+
+	// Pick cluster start positions, clusters never overlap
+
+	size_t nClusters = (size_t) (mParams.mLines * mParams.mEditDensity / mParams.mClusterSize);
+
+	std::vector<size_t> starts;
+
+	for (size_t i = 0; i < nClusters; i++)
+	{
+		starts.push_back (nextIndex (mParams.mLines));
+	}
+
+	std::sort (starts.begin (), starts.end ());
+
+	size_t pos = 0;
+
+	for (size_t start : starts)
+	{
+		if (start < pos)
+		{
+			continue;
+		}
+
+		dest.insert (dest.end (), source.begin () + pos, source.begin () + start);
+
+		size_t length = 1 + nextIndex (2 * mParams.mClusterSize - 1);
+		size_t end = std::min (start + length, source.size ());
+
+		switch (nextIndex (3))
+		{
+		case 0:		// replace
+
+			for (size_t i = start; i < end; i++)
+			{
+				dest.push_back (makeLine ());
+			}
+
+			pos = end;
+			break;
+
+		case 1:		// delete
+
+			pos = end;
+			break;
+
+		default:	// insert
+
+			for (size_t i = 0; i < length; i++)
+			{
+				dest.push_back (makeLine ());
+			}
+
+			pos = start;
+			break;
+		}
+
+		// Keep at least one line between clusters
+
+		if (pos < source.size ())
+		{
+			dest.push_back (source [pos ++]);
+		}
+	}
+
+	dest.insert (dest.end (), source.begin () + pos, source.end ());
+
+	join (source, outSource);
+	join (dest, outDest);
+}
@@ -0,0 +1,80 @@
+#ifndef __CCorpusGenerator_h
+#define __CCorpusGenerator_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+//
+//	struct CCorpusParams
+//
+//	Knobs of the synthetic corpus
+//
+
+struct CCorpusParams
+{
+	CCorpusParams () :
+		mLines (1000),
+		mLineLength (40),
+		mEditDensity (0.05),
+		mClusterSize (3),
+		mDuplicateRatio (0.1),
+		mSeed (1)
+	{
+	}
+
+	size_t mLines;				// lines in the first file
+	size_t mLineLength;			// average line length
+	double mEditDensity;		// share of the first file lines touched by edits
+	size_t mClusterSize;		// average number of adjacent lines per edit
+	double mDuplicateRatio;		// share of lines taken from a small pool of repeated lines
+	uint64_t mSeed;				// same seed and knobs give the same corpus
+};
+
+
+//
+//	class CCorpusGenerator
+//
+//	Deterministic generator of (TA, TB) text file pairs for benchmarking.
+//	TB is TA with a number of edit clusters applied, each cluster either
+//	replaces, deletes or inserts a few adjacent lines
+//
+
+class CCorpusGenerator
+{
+public:
+
+	explicit CCorpusGenerator (const CCorpusParams &inParams);
+
+	virtual ~CCorpusGenerator ();
+
+	void generate (std::string &outSource, std::string &outDest);
+
+protected:
+
+	// prevent compiler autogeneration
+	CCorpusGenerator ();
+	CCorpusGenerator (const CCorpusGenerator &);
+	CCorpusGenerator &operator= (const CCorpusGenerator &);
+
+	// splitmix64 sequence, stable across platforms and libraries
+
+	uint64_t next ();
+	size_t nextIndex (size_t inRange);
+	double nextDouble ();
+
+	std::string makeLine ();
+
+	static void join (const std::vector<std::string> &inLines, std::string &outText);
+
+	CCorpusParams mParams;
+
+	uint64_t mState;
+	uint64_t mSerial;
+
+	std::vector<std::string> mPool;		// repeated lines
+};
+
+
+#endif	// __CCorpusGenerator_h
@@ -1,71 +1,175 @@
-#include "stdafx.h"
-
-#include "CDataSourceTextFile.h"
-
-//
-//	class CDataSourceTextFile
-//
-
-CDataSourceTextFile::CDataSourceTextFile(FILE *file)
-	: mFile(file)
-{
-}
-
-
-CDataSourceTextFile::~CDataSourceTextFile()
-{
-	clearData();
-}
-
-
-// Get the data at a specified offset
-bool
-CDataSourceTextFile::getAt(size_t index, const data_type **data) const
-{
-	// the caller will request one beyond the end, so return NULL
-	if (index >= mData.size())
-		*data = NULL;
-	else
-		*data = &mData.at(index);
-
-	return true;
-}
-
-
-// clear the data buffer
-void
-CDataSourceTextFile::clearData()
-{
-	mData.erase(mData.begin(), mData.end());
-}
-
-
-// Read the data into the buffer
-void CDataSourceTextFile::retrieveData()
-{
-	char buffer[4096];
-
-	THROW_IF_NOT(mData.size() == 0, XRuntime);
-	while (!feof(mFile))
-	{
-		buffer[0] = '\0';
-
-		if (fgets(buffer, sizeof(buffer) / sizeof(buffer[0]), mFile) == NULL)
-		{
-			THROW_IF_NOT(feof(mFile), XCantRead);
-			break;
-		}
-
-		// remove trailing \n or \r
-
-		char c;
-		int len;
-
-		while (((c = buffer[(len = strlen(buffer)) - 1]) == '\n') || (c == '\r'))
-		{
-			buffer[len - 1] = '\0';
-		}
-
-		mData.push_back(buffer);
-	}
-}
+#include "stdafx.h"
+
+#include "CDataSourceTextFile.h"
+#include "CLineReader.h"
+
+#include <memory>
+
+
+//
+//	class CHashedString
+//
+
+uint64_t CHashedString::sHashSeed = CHash::kDefaultSeed;
+bool CHashedString::sCollectStats = false;
+
+std::atomic<uint64_t> CHashedString::sHashMatches (0);
+std::atomic<uint64_t> CHashedString::sHashCollisions (0);
+
+
+static inline bool
+isBlank(char c)
+{
+	return c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\f'  ||  c == '\v';
+}
+
+
+static inline size_t
+trimmedLength(const char *inData, size_t inLength)
+{
+	while (inLength > 0  &&  isBlank(inData[inLength - 1]))
+	{
+		inLength--;
+	}
+
+	return inLength;
+}
+
+
+uint64_t
+CHashedString::hashNormalized(const char *inData, size_t inLength, ENormalization inMode)
+{
+	inLength = trimmedLength(inData, inLength);
+
+	if (inMode == kNormalizeTrailing)
+	{
+		return (CHash::compute(inData, inLength, sHashSeed) & ~(uint64_t) kNormalizeMask) | inMode;
+	}
+
+	// Whitespace runs collapse to a single space
+
+	std::string text;
+	text.reserve(inLength);
+
+	for (size_t i = 0; i < inLength; i++)
+	{
+		if (! isBlank(inData[i]))
+		{
+			text += inData[i];
+		}
+		else if (i == 0  ||  ! isBlank(inData[i - 1]))
+		{
+			text += ' ';
+		}
+	}
+
+	return (CHash::compute(text.data(), text.size(), sHashSeed) & ~(uint64_t) kNormalizeMask) | inMode;
+}
+
+
+bool
+CHashedString::equalNormalized(const CHashedString &inRight) const
+{
+	const char *a = data();
+	const char *b = inRight.data();
+
+	size_t lengthA = trimmedLength(a, size());
+	size_t lengthB = trimmedLength(b, inRight.size());
+
+	if (getNormalization() == kNormalizeTrailing)
+	{
+		return lengthA == lengthB  &&  memcmp(a, b, lengthA) == 0;
+	}
+
+	size_t i = 0, j = 0;
+
+	while (i < lengthA  &&  j < lengthB)
+	{
+		bool blankA = isBlank(a[i]);
+
+		if (blankA != isBlank(b[j]))
+		{
+			return false;
+		}
+
+		if (blankA)
+		{
+			while (i < lengthA  &&  isBlank(a[i])) i++;
+			while (j < lengthB  &&  isBlank(b[j])) j++;
+		}
+		else if (a[i++] != b[j++])
+		{
+			return false;
+		}
+	}
+
+	return i == lengthA  &&  j == lengthB;
+}
+
+
+//
+//	class CDataSourceTextFile
+//
+
+CDataSourceTextFile::CDataSourceTextFile(FILE *file)
+	: mFile(file), mMemory(NULL), mMemoryLength(0), mNormalization(CHashedString::kNormalizeNone)
+{
+}
+
+
+CDataSourceTextFile::CDataSourceTextFile(const char *data, size_t length)
+	: mFile(NULL), mMemory((data != NULL) ? data : ""), mMemoryLength(length),
+	mNormalization(CHashedString::kNormalizeNone)
+{
+	THROW_IF(data == NULL  &&  length != 0, XBadParameter);
+}
+
+
+CDataSourceTextFile::~CDataSourceTextFile()
+{
+	clearData();
+}
+
+
+// Get the data at a specified offset
+bool
+CDataSourceTextFile::getAt(size_t index, const data_type **data) const
+{
+	// the caller will request one beyond the end, so return NULL
+	if (index >= mData.size())
+		*data = NULL;
+	else
+		*data = &mData.at(index);
+
+	return true;
+}
+
+
+// clear the data buffer
+void
+CDataSourceTextFile::clearData()
+{
+	mData.erase(mData.begin(), mData.end());
+}
+
+
+// Read the data into the buffer
+void CDataSourceTextFile::retrieveData()
+{
+	THROW_IF_NOT(mData.size() == 0, XRuntime);
+
+	STATS_PHASE (kPhaseRead);
+
+	std::unique_ptr<CLineReader> reader((mMemory != NULL) ?
+		new CLineReader(mMemory, mMemoryLength) : new CLineReader(mFile, true));
+
+	const char *line;
+	size_t len;
+
+	while (reader->readLine(&line, &len))
+	{
+		mData.emplace_back(line, len, mNormalization);
+	}
+
+	STATS_COUNT (kLinesRead, mData.size());
+}
@@ -1,130 +1,259 @@
-#ifndef __CDataSourceTextFile_h
-#define __CDataSourceTextFile_h
-
-#include "CCompare.h"
-
-
-//
-//	class CHashedString
-//
-//	Special aux lightweight case of std::string with fast comparing via hash-value
-//
-
-class CHashedString : public std::string
-{
-public:
-
-	CHashedString()
-	{
-		mHashValue = 0;
-	}
-
-	CHashedString(const char *inData) :
-		std::string(inData)
-	{
-		recalcHashValue();
-	}
-
-	CHashedString(const CHashedString &inData) :
-		std::string(inData)
-	{
-		recalcHashValue();
-	}
-
-	virtual ~CHashedString()
-	{
-	}
-
-	CHashedString& operator=(const CHashedString& _Right)
-	{
-		mHashValue = _Right.mHashValue;
-		std::string::assign(_Right);
-		return *this;
-	}
-
-	CHashedString& operator=(const char *_Right)
-	{
-		std::string::assign(_Right);
-		recalcHashValue();
-		return *this;
-	}
-
-	// accelerated compare func
-	int compare(const CHashedString& _Right) const
-	{
-		return (_Right.getHashValue() == mHashValue) ?
-			std::string::compare(_Right) : 1;
-	}
-
-	inline size_t getHashValue() const
-	{
-		return mHashValue;
-	}
-
-protected:
-
-	void recalcHashValue()
-	{
-		mHashValue = std::hash<std::string>{}(*this);
-	}
-
-	size_t mHashValue;
-};
-
-
-// special case for a string pointer uses the length() method
-// to determine a zero length string
-
-inline bool isNull(const CHashedString *t)
-{
-	return (t == NULL);
-}
-
-
-// special case for a string pointer uses the compare() method
-// to compare the two hash strings
-
-inline bool isEqualTo(const CHashedString * const t1, const CHashedString * const t2)
-{
-	THROW_IF(t1 == nullptr || t2 == nullptr, XBadParameter);
-	return (t1->compare(*t2) == 0);
-}
-
-
-//
-//	class CDataSourceTextFile
-//
-
-class CDataSourceTextFile
-{
-public:
-	// public typedef to define the data type
-	typedef CHashedString data_type;
-
-private:
-	FILE                     *mFile;
-	std::vector<CHashedString>  mData;
-
-protected:
-
-	// prevent compiler autogeneration
-	CDataSourceTextFile();
-	CDataSourceTextFile(const CDataSourceTextFile &);
-	CDataSourceTextFile &operator=(const CDataSourceTextFile &);
-
-public:
-
-	explicit CDataSourceTextFile(FILE *file);
-
-	virtual ~CDataSourceTextFile();
-
-	// all data source classes must define the following interface
-	void clearData ();
-	bool getAt (size_t index, const data_type **data) const;
-	const data_type *getBaseData () const { return NULL; }
-	size_t getSize () const { return mData.size(); }
-	void retrieveData ();
-};
-
-
-#endif  // __CDataSourceTextFile_h
+#ifndef __CDataSourceTextFile_h
+#define __CDataSourceTextFile_h
+
+#include <atomic>
+
+#include "CCompare.h"
+#include "CHash.h"
+
+
+//
+//	class CHashedString
+//
+//	Special aux lightweight case of std::string with fast comparing via hash-value
+//
+
+class CHashedString : public std::string
+{
+public:
+
+	// Whitespace differences ignored by compare (), the mode lives in the low bits
+	// of the hash value, so exact lines pay nothing for it. Line ends never matter,
+	// CLineReader strips '\r'
+
+	enum ENormalization
+	{
+		kNormalizeNone = 0,
+		kNormalizeTrailing = 1,		// trailing whitespace
+		kNormalizeSpace = 2,		// ...and the amount of whitespace elsewhere
+		kNormalizeMask = 3
+	};
+
+	CHashedString()
+	{
+		mHashValue = CHash::compute("", 0, sHashSeed) & ~(uint64_t) kNormalizeMask;
+	}
+
+	CHashedString(const char *inData) :
+		std::string(inData)
+	{
+		recalcHashValue();
+	}
+
+	// Takes the line and hashes it while its bytes are still hot in cache
+
+	CHashedString(const char *inData, size_t inLength) :
+		std::string(inData, inLength)
+	{
+		mHashValue = CHash::compute(inData, inLength, sHashSeed) & ~(uint64_t) kNormalizeMask;
+	}
+
+	// Text is kept as is, only the hash and compare () see it normalized
+
+	CHashedString(const char *inData, size_t inLength, ENormalization inMode) :
+		std::string(inData, inLength)
+	{
+		mHashValue = (inMode == kNormalizeNone) ?
+			CHash::compute(inData, inLength, sHashSeed) & ~(uint64_t) kNormalizeMask :
+			hashNormalized(inData, inLength, inMode);
+	}
+
+	CHashedString(const CHashedString &inData) :
+		std::string(inData),
+		mHashValue(inData.mHashValue)
+	{
+	}
+
+	CHashedString(CHashedString &&inData) noexcept :
+		std::string(std::move(inData)),
+		mHashValue(inData.mHashValue)
+	{
+	}
+
+	virtual ~CHashedString()
+	{
+	}
+
+	CHashedString& operator=(const CHashedString& _Right)
+	{
+		mHashValue = _Right.mHashValue;
+		std::string::assign(_Right);
+		return *this;
+	}
+
+	CHashedString& operator=(CHashedString&& _Right) noexcept
+	{
+		mHashValue = _Right.mHashValue;
+		std::string::assign(std::move(_Right));
+		return *this;
+	}
+
+	CHashedString& operator=(const char *_Right)
+	{
+		std::string::assign(_Right);
+		recalcHashValue();
+		return *this;
+	}
+
+	// accelerated compare func, hash first and then plain memory compare
+	// of equally sized strings (libc memcmp is vectorised)
+
+	int compare(const CHashedString& _Right) const
+	{
+		if (_Right.mHashValue != mHashValue)
+		{
+			return 1;
+		}
+
+		int result;
+
+		if ((mHashValue & kNormalizeMask) != kNormalizeNone)
+		{
+			result = equalNormalized(_Right) ? 0 : 1;
+		}
+		else
+		{
+			result = (size() == _Right.size()) ?
+				memcmp(data(), _Right.data(), size()) : 1;
+		}
+
+		if (sCollectStats)
+		{
+			countCompare(result != 0);
+		}
+
+		return result;
+	}
+
+	inline uint64_t getHashValue() const
+	{
+		return mHashValue;
+	}
+
+	// Call it after the string was modified via std::string interface
+
+	void recalcHashValue()
+	{
+		mHashValue = CHash::compute(data(), size(), sHashSeed) & ~(uint64_t) kNormalizeMask;
+	}
+
+	ENormalization getNormalization() const
+	{
+		return (ENormalization) (mHashValue & kNormalizeMask);
+	}
+
+	// Hash seed is shared by all strings, so set it before any string is created
+
+	static void setHashSeed(uint64_t inSeed) { sHashSeed = inSeed; }
+	static uint64_t getHashSeed() { return sHashSeed; }
+
+	// Collision statistics of compare ()
+
+	static void enableStats(bool inEnable) { sCollectStats = inEnable; }
+
+	static uint64_t getHashMatches() { return sHashMatches; }
+	static uint64_t getHashCollisions() { return sHashCollisions; }
+
+protected:
+
+	static uint64_t hashNormalized(const char *inData, size_t inLength, ENormalization inMode);
+
+	bool equalNormalized(const CHashedString &inRight) const;
+
+	static void countCompare(bool inCollision)
+	{
+		sHashMatches.fetch_add(1, std::memory_order_relaxed);
+
+		if (inCollision)
+		{
+			sHashCollisions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t mHashValue;
+
+	static uint64_t sHashSeed;
+	static bool sCollectStats;
+
+	static std::atomic<uint64_t> sHashMatches;		// compares with equal hashes
+	static std::atomic<uint64_t> sHashCollisions;	// ...and different strings
+};
+
+
+// special case for a string pointer uses the length() method
+// to determine a zero length string
+
+inline bool isNull(const CHashedString *t)
+{
+	return (t == NULL);
+}
+
+
+// special case for a string pointer uses the compare() method
+// to compare the two hash strings
+
+inline bool isEqualTo(const CHashedString * const t1, const CHashedString * const t2)
+{
+	THROW_IF(t1 == nullptr || t2 == nullptr, XBadParameter);
+	return (t1->compare(*t2) == 0);
+}
+
+
+// lines are hashed once while read
+
+inline uint64_t hashOf(const CHashedString * const t)
+{
+	THROW_IF(t == nullptr, XBadParameter);
+	return t->getHashValue();
+}
+
+
+//
+//	class CDataSourceTextFile
+//
+
+class CDataSourceTextFile
+{
+public:
+	// public typedef to define the data type
+	typedef CHashedString data_type;
+
+private:
+	FILE                     *mFile;
+	const char               *mMemory;		// buffer to split instead of the file
+	size_t                    mMemoryLength;
+	std::vector<CHashedString>  mData;
+	CHashedString::ENormalization mNormalization;
+
+protected:
+
+	// prevent compiler autogeneration
+	CDataSourceTextFile();
+	CDataSourceTextFile(const CDataSourceTextFile &);
+	CDataSourceTextFile &operator=(const CDataSourceTextFile &);
+
+public:
+
+	explicit CDataSourceTextFile(FILE *file);
+
+	// lines are copied by retrieveData(), the buffer is not needed after it
+	CDataSourceTextFile(const char *data, size_t length);
+
+	virtual ~CDataSourceTextFile();
+
+	// Whitespace differences to ignore, set before retrieveData()
+	void setNormalization(CHashedString::ENormalization inMode) { mNormalization = inMode; }
+	CHashedString::ENormalization getNormalization() const { return mNormalization; }
+
+	// all data source classes must define the following interface
+	void clearData ();
+	bool getAt (size_t index, const data_type **data) const;
+	const data_type *getBaseData () const { return NULL; }
+	// lines are kept in one array, CCompare reads them directly
+	const data_type *getData () const { return mData.data(); }
+	size_t getSize () const { return mData.size(); }
+	void retrieveData ();
+};
+
+
+#endif  // __CDataSourceTextFile_h
@@ -0,0 +1,363 @@
+#include "stdafx.h"
+
+#include "CFrameCodec.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "CHash.h"
+
+
+static const char sMagic [CFrameCodec::kMagicSize] = { 'S', 'C', 'Z', '1' };
+
+static const uint32_t kStoredFlag = 0x80000000u;
+
+static const size_t kMinMatch = 4;
+static const size_t kMaxOffset = 0xFFFF;
+static const unsigned kHashBits = 14;
+
+
+static inline uint32_t
+read32 (const void *inData)
+{
+	const uint8_t *p = static_cast<const uint8_t *> (inData);
+
+	return (uint32_t) p [0] | ((uint32_t) p [1] << 8) | ((uint32_t) p [2] << 16) | ((uint32_t) p [3] << 24);
+}
+
+
+static inline void
+append32 (std::string &ioData, uint32_t inValue)
+{
+	char bytes [4] = { (char) inValue, (char) (inValue >> 8), (char) (inValue >> 16), (char) (inValue >> 24) };
+
+	ioData.append (bytes, 4);
+}
+
+
+// Length past a nibble of 15, as 255 bytes and the remainder
+
+static inline void
+appendLength (std::string &ioData, size_t inLength)
+{
+	for (; inLength >= 255; inLength -= 255)
+	{
+		ioData += (char) 255;
+	}
+
+	ioData += (char) inLength;
+}
+
+
+static inline size_t
+readLength (const uint8_t *&ioData, const uint8_t *inEnd)
+{
+	size_t length = 0;
+	uint8_t byte;
+
+	do
+	{
+		THROW_IF_WINFO (ioData == inEnd, XCantDecode, "Truncated length");
+
+		byte = *ioData ++;
+		length += byte;
+	}
+	while (byte == 255);
+
+	return length;
+}
+
+
+static inline uint32_t
+checksum (const char *inData, size_t inLength)
+{
+	return (uint32_t) CHash::compute (inData, inLength);
+}
+
+
+//
+//	class CFrameCodec
+//
+
+bool
+CFrameCodec::isCompressed (const char *inData, size_t inLength)
+{
+	return inLength >= kMagicSize  &&  memcmp (inData, sMagic, kMagicSize) == 0;
+}
+
+
+void
+CFrameCodec::writeMagic (std::string &outData)
+{
+	outData.append (sMagic, kMagicSize);
+}
+
+
+void
+CFrameCodec::writeEnd (std::string &outData)
+{
+	append32 (outData, 0);
+	append32 (outData, 0);
+	append32 (outData, 0);
+}
+
+
+void
+CFrameCodec::encode (const char *inData, size_t inLength, std::string &outData)
+{
+	while (inLength > 0)
+	{
+		size_t raw = std::min (inLength, kMaxFrameSize);
+		size_t header = outData.size ();
+
+		outData.append (kHeaderSize, '\0');
+
+		compressBlock (inData, raw, outData);
+
+		size_t payload = outData.size () - header - kHeaderSize;
+		uint32_t flags = 0;
+
+		if (payload >= raw)
+		{
+			// Incompressible, keep it as is
+
+			outData.resize (header + kHeaderSize);
+			outData.append (inData, raw);
+
+			payload = raw;
+			flags = kStoredFlag;
+		}
+
+		std::string fields;
+
+		append32 (fields, (uint32_t) raw);
+		append32 (fields, (uint32_t) payload | flags);
+		append32 (fields, checksum (inData, raw));
+
+		outData.replace (header, kHeaderSize, fields);
+
+		inData += raw;
+		inLength -= raw;
+	}
+}
+
+
+void
+CFrameCodec::readHeader (const char *inHeader, size_t *outRawLength, size_t *outPayloadLength)
+{
+	uint32_t raw = read32 (inHeader);
+	uint32_t payload = read32 (inHeader + 4);
+
+	THROW_IF_WINFO (raw > kMaxFrameSize, XCantDecode, "Frame too long");
+
+	if (payload & kStoredFlag)
+	{
+		payload &= ~kStoredFlag;
+		THROW_IF_WINFO (payload != raw, XCantDecode, "Stored frame length mismatch");
+	}
+
+	*outRawLength = raw;
+	*outPayloadLength = payload;
+}
+
+
+void
+CFrameCodec::decodeFrame (const char *inHeader, const char *inPayload, char *outData)
+{
+	size_t raw, payload;
+
+	readHeader (inHeader, &raw, &payload);
+
+	if (read32 (inHeader + 4) & kStoredFlag)
+	{
+		memcpy (outData, inPayload, raw);
+	}
+	else
+	{
+		decompressBlock (inPayload, payload, outData, raw);
+	}
+
+	THROW_IF_WINFO (checksum (outData, raw) != read32 (inHeader + 8), XCantDecode, "Frame checksum mismatch");
+}
+
+
+void
+CFrameCodec::decode (const char *inData, size_t inLength, std::string &outData)
+{
+	THROW_IF_WINFO (! isCompressed (inData, inLength), XCantDecode, "No compressed stream magic");
+
+	const char *p = inData + kMagicSize;
+	const char *end = inData + inLength;
+
+	for (;;)
+	{
+		THROW_IF_WINFO ((size_t) (end - p) < kHeaderSize, XCantDecode, "Truncated compressed stream");
+
+		size_t raw, payload;
+
+		readHeader (p, &raw, &payload);
+
+		if (raw == 0)
+		{
+			break;
+		}
+
+		THROW_IF_WINFO ((size_t) (end - p - kHeaderSize) < payload, XCantDecode, "Truncated frame");
+
+		size_t used = outData.size ();
+
+		outData.resize (used + raw);
+		decodeFrame (p, p + kHeaderSize, &outData [used]);
+
+		p += kHeaderSize + payload;
+	}
+}
+
+
+// Greedy matching against the last position of every 4-byte hash, literal
+// runs without matches are skipped at growing steps
+
+void
+CFrameCodec::compressBlock (const char *inData, size_t inLength, std::string &outData)
+{
+	std::vector<uint32_t> table (size_t (1) << kHashBits, 0);
+
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (inData);
+
+	size_t anchor = 0;
+	size_t pos = 0;
+
+	while (pos + kMinMatch <= inLength)
+	{
+		uint32_t sequence = read32 (in + pos);
+		uint32_t &slot = table [(sequence * 2654435761u) >> (32 - kHashBits)];
+
+		size_t candidate = slot;
+		slot = (uint32_t) pos;
+
+		if (candidate >= pos  ||  pos - candidate > kMaxOffset  ||  read32 (in + candidate) != sequence)
+		{
+			pos += 1 + ((pos - anchor) >> 6);
+			continue;
+		}
+
+		size_t match = kMinMatch;
+
+		while (pos + match < inLength  &&  in [candidate + match] == in [pos + match])
+		{
+			match ++;
+		}
+
+		size_t literals = pos - anchor;
+		size_t extra = match - kMinMatch;
+
+		outData += (char) ((std::min (literals, size_t (15)) << 4) | std::min (extra, size_t (15)));
+
+		if (literals >= 15)
+		{
+			appendLength (outData, literals - 15);
+		}
+
+		outData.append (inData + anchor, literals);
+
+		outData += (char) (pos - candidate);
+		outData += (char) ((pos - candidate) >> 8);
+
+		if (extra >= 15)
+		{
+			appendLength (outData, extra - 15);
+		}
+
+		pos += match;
+		anchor = pos;
+
+		if (pos + kMinMatch <= inLength)
+		{
+			table [(read32 (in + pos - 2) * 2654435761u) >> (32 - kHashBits)] = (uint32_t) (pos - 2);
+		}
+	}
+
+	// Last literals, the payload ends with them
+
+	size_t literals = inLength - anchor;
+
+	outData += (char) (std::min (literals, size_t (15)) << 4);
+
+	if (literals >= 15)
+	{
+		appendLength (outData, literals - 15);
+	}
+
+	outData.append (inData + anchor, literals);
+}
+
+
+void
+CFrameCodec::decompressBlock (const char *inData, size_t inLength, char *outData, size_t inRawLength)
+{
+	const uint8_t *ip = reinterpret_cast<const uint8_t *> (inData);
+	const uint8_t *end = ip + inLength;
+
+	char *op = outData;
+	char *limit = outData + inRawLength;
+
+	while (ip < end)
+	{
+		uint8_t token = *ip ++;
+
+		size_t literals = token >> 4;
+
+		if (literals == 15)
+		{
+			literals += readLength (ip, end);
+		}
+
+		THROW_IF_WINFO ((size_t) (end - ip) < literals  ||  (size_t) (limit - op) < literals,
+			XCantDecode, "Literals out of frame");
+
+		memcpy (op, ip, literals);
+		ip += literals;
+		op += literals;
+
+		if (ip == end)
+		{
+			break;
+		}
+
+		THROW_IF_WINFO (end - ip < 2, XCantDecode, "Truncated match");
+
+		size_t offset = ip [0] | (ip [1] << 8);
+		ip += 2;
+
+		size_t match = (token & 15) + kMinMatch;
+
+		if ((token & 15) == 15)
+		{
+			match += readLength (ip, end);
+		}
+
+		THROW_IF_WINFO (offset == 0  ||  offset > (size_t) (op - outData)  ||  (size_t) (limit - op) < match,
+			XCantDecode, "Match out of frame");
+
+		const char *from = op - offset;
+
+		if (offset >= match)
+		{
+			memcpy (op, from, match);
+			op += match;
+		}
+		else
+		{
+			// Overlapping copy repeats the last offset bytes
+
+			for (size_t i = 0; i < match; i++)
+			{
+				*op ++ = *from ++;
+			}
+		}
+	}
+
+	THROW_IF_WINFO (op != limit, XCantDecode, "Frame length mismatch");
+}
@@ -0,0 +1,70 @@
+#ifndef __CFrameCodec_h
+#define __CFrameCodec_h
+
+#include <stdint.h>
+#include <string>
+
+#include "XExceptions.h"
+
+
+//
+//	class CFrameCodec
+//
+//	Compressed changeset format. A stream is the "SCZ1" magic followed by
+//	frames, every frame decodes on its own:
+//
+//		u32 raw length, 0 ends the stream
+//		u32 payload length, the top bit set if the payload is stored raw
+//		u32 low half of CHash of the raw bytes
+//		payload
+//
+//	Numbers are little-endian. Payloads are LZ77 sequences with a 64K window:
+//	a token of literal and match length nibbles, extra length bytes if a nibble
+//	is 15, the literals, then unless the payload ends the 16-bit match offset
+//	and extra match length bytes
+//
+
+class CFrameCodec
+{
+public:
+
+	static const size_t kMagicSize = 4;
+	static const size_t kHeaderSize = 12;
+
+	// Raw bytes of a frame, longer data is split
+	static const size_t kMaxFrameSize = 4 * 1024 * 1024;
+
+	static bool isCompressed (const char *inData, size_t inLength);
+
+	// Append the magic, the frames of the data and, if asked, the end mark
+
+	static void writeMagic (std::string &outData);
+	static void encode (const char *inData, size_t inLength, std::string &outData);
+	static void writeEnd (std::string &outData);
+
+	// Raw and payload length of a frame, throws XCantDecode on garbage
+
+	static void readHeader (const char *inHeader, size_t *outRawLength, size_t *outPayloadLength);
+
+	// Decode frame whose header was read into outData of its raw length
+
+	static void decodeFrame (const char *inHeader, const char *inPayload, char *outData);
+
+	// Decode whole stream, the magic included
+
+	static void decode (const char *inData, size_t inLength, std::string &outData);
+
+protected:
+
+	// prevent compiler autogeneration
+	CFrameCodec ();
+	CFrameCodec (const CFrameCodec &);
+	CFrameCodec &operator= (const CFrameCodec &);
+
+	static void compressBlock (const char *inData, size_t inLength, std::string &outData);
+
+	static void decompressBlock (const char *inData, size_t inLength, char *outData, size_t inRawLength);
+};
+
+
+#endif	// __CFrameCodec_h
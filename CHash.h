@@ -0,0 +1,230 @@
+#ifndef __CHash_h
+#define __CHash_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+	#pragma intrinsic(_umul128)
+#endif
+
+
+//
+//	class CHash
+//
+//	Fast seedable 64-bit hash of a byte block (wyhash family).
+//	Results do not depend on the standard library in use, but they
+//	do assume little-endian byte order of the host
+//
+
+class CHash
+{
+public:
+
+	static const uint64_t kDefaultSeed = 0x5cc5a1e9d3b7f021ull;
+
+	static inline uint64_t compute(const void *inData, size_t inLength, uint64_t inSeed = kDefaultSeed)
+	{
+		const uint8_t *p = static_cast<const uint8_t *>(inData);
+		uint64_t seed = inSeed ^ mix(inSeed ^ kSecret0, kSecret1);
+		uint64_t a, b;
+
+		if (inLength <= 16)
+		{
+			if (inLength >= 4)
+			{
+				a = (read4(p) << 32) | read4(p + ((inLength >> 3) << 2));
+				b = (read4(p + inLength - 4) << 32) | read4(p + inLength - 4 - ((inLength >> 3) << 2));
+			}
+			else if (inLength > 0)
+			{
+				a = read3(p, inLength);
+				b = 0;
+			}
+			else
+			{
+				a = b = 0;
+			}
+		}
+		else
+		{
+			size_t i = inLength;
+
+			if (i >= 48)
+			{
+				uint64_t see1 = seed, see2 = seed;
+
+				do
+				{
+					seed = mix(read8(p) ^ kSecret1, read8(p + 8) ^ seed);
+					see1 = mix(read8(p + 16) ^ kSecret2, read8(p + 24) ^ see1);
+					see2 = mix(read8(p + 32) ^ kSecret3, read8(p + 40) ^ see2);
+					p += 48;
+					i -= 48;
+				}
+				while (i >= 48);
+
+				seed ^= see1 ^ see2;
+			}
+
+			while (i > 16)
+			{
+				seed = mix(read8(p) ^ kSecret1, read8(p + 8) ^ seed);
+				i -= 16;
+				p += 16;
+			}
+
+			a = read8(p + i - 16);
+			b = read8(p + i - 8);
+		}
+
+		a ^= kSecret1;
+		b ^= seed;
+		multiply(a, b);
+
+		return mix(a ^ kSecret0 ^ inLength, b ^ kSecret1);
+	}
+
+private:
+
+	static const uint64_t kSecret0 = 0xa0761d6478bd642full;
+	static const uint64_t kSecret1 = 0xe7037ed1a0b428dbull;
+	static const uint64_t kSecret2 = 0x8ebc6af09c88c6e3ull;
+	static const uint64_t kSecret3 = 0x589965cc75374cc3ull;
+
+	// 64x64 -> 128 bit multiplication, low part goes to A, high part to B
+
+	static inline void multiply(uint64_t &A, uint64_t &B)
+	{
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 r = A;
+		r *= B;
+		A = (uint64_t) r;
+		B = (uint64_t) (r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		A = _umul128(A, B, &B);
+#else
+		uint64_t ha = A >> 32, hb = B >> 32, la = (uint32_t) A, lb = (uint32_t) B;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		uint64_t t = rl + (rm0 << 32), c = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		c += lo < t;
+		A = lo;
+		B = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+	}
+
+	static inline uint64_t mix(uint64_t A, uint64_t B)
+	{
+		multiply(A, B);
+		return A ^ B;
+	}
+
+	static inline uint64_t read8(const uint8_t *p)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static inline uint64_t read4(const uint8_t *p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static inline uint64_t read3(const uint8_t *p, size_t k)
+	{
+		return (((uint64_t) p[0]) << 16) | (((uint64_t) p[k >> 1]) << 8) | p[k - 1];
+	}
+};
+
+
+//
+//	class CFingerprint
+//
+//	128-bit fingerprint of a text as a sequence of lines, line ends excluded.
+//	Two hash chains of different seeds run over the lines, the hash of every
+//	line seeding the next one
+//
+
+class CFingerprint
+{
+public:
+
+	static const size_t kTextLength = 32;	// hex digits
+
+	CFingerprint() : mLow(kSeedLow), mHigh(kSeedHigh) { }
+
+	void addLine(const void *inData, size_t inLength)
+	{
+		mLow = CHash::compute(inData, inLength, mLow);
+		mHigh = CHash::compute(inData, inLength, mHigh);
+	}
+
+	bool operator==(const CFingerprint &inOther) const
+		{ return mLow == inOther.mLow  &&  mHigh == inOther.mHigh; }
+
+	bool operator!=(const CFingerprint &inOther) const
+		{ return ! (*this == inOther); }
+
+	std::string toString() const
+	{
+		static const char sDigits[] = "0123456789abcdef";
+
+		std::string text(kTextLength, '0');
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			text[15 - i] = sDigits[(mHigh >> (i * 4)) & 15];
+			text[31 - i] = sDigits[(mLow >> (i * 4)) & 15];
+		}
+
+		return text;
+	}
+
+	// Read back toString() output, false if it is not one
+
+	bool parse(const char *inText, size_t inLength)
+	{
+		if (inLength != kTextLength)
+		{
+			return false;
+		}
+
+		uint64_t half[2] = { 0, 0 };
+
+		for (size_t i = 0; i < kTextLength; i++)
+		{
+			char c = inText[i];
+			uint64_t digit;
+
+			if (c >= '0'  &&  c <= '9')			digit = c - '0';
+			else if (c >= 'a'  &&  c <= 'f')	digit = c - 'a' + 10;
+			else if (c >= 'A'  &&  c <= 'F')	digit = c - 'A' + 10;
+			else return false;
+
+			half[i / 16] = (half[i / 16] << 4) | digit;
+		}
+
+		mHigh = half[0];
+		mLow = half[1];
+
+		return true;
+	}
+
+private:
+
+	static const uint64_t kSeedLow = 0x3c6ef372fe94f82bull;
+	static const uint64_t kSeedHigh = 0xa54ff53a5f1d36f1ull;
+
+	uint64_t mLow;
+	uint64_t mHigh;
+};
+
+
+#endif  // __CHash_h
@@ -0,0 +1,277 @@
+#include "stdafx.h"
+
+#include "CIntraline.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "CCompare.h"
+#include "CChangeSetProcessor.h"
+
+
+// Units of a word diff: runs of word characters, runs of blanks, single others
+
+static void
+splitWords (const char *inText, size_t inLength, std::vector<size_t> &outBounds)
+{
+	outBounds.clear ();
+	outBounds.push_back (0);
+
+	size_t i = 0;
+
+	while (i < inLength)
+	{
+		unsigned char c = inText [i];
+
+		if (isalnum (c)  ||  c == '_')
+		{
+			while (i < inLength  &&  (isalnum ((unsigned char) inText [i])  ||  inText [i] == '_')) i ++;
+		}
+		else if (c == ' '  ||  c == '\t')
+		{
+			while (i < inLength  &&  (inText [i] == ' '  ||  inText [i] == '\t')) i ++;
+		}
+		else
+		{
+			i ++;
+		}
+
+		outBounds.push_back (i);
+	}
+}
+
+
+static void
+appendEdit (std::string &ioEdits, char inOp, size_t inLength, const char *inText = NULL)
+{
+	if (inLength == 0)
+	{
+		return;
+	}
+
+	ioEdits += inOp;
+	ioEdits += std::to_string (inLength);
+
+	if (inText != NULL)
+	{
+		ioEdits += ':';
+		ioEdits.append (inText, inLength);
+	}
+}
+
+
+// Edit script of the middles in units, mapped to bytes by the unit bounds
+
+template<typename T>
+static bool
+diffUnits (T *inBase, T *inLine, const std::vector<size_t> &inBaseBounds,
+	const std::vector<size_t> &inLineBounds, const char *inLineText, std::string &outEdits)
+{
+	typedef cmp::CCompare<T> CompareT;
+	CompareT compare (inBase, inLine);
+
+	typename CompareT::CResultSet seq;
+
+	if (compare.process (&seq) == -1)
+	{
+		return false;
+	}
+
+	size_t kept = 0;
+
+	for (const cmp::CEditRun &run : seq)
+	{
+		// Insertions index the line, the other runs the base
+
+		const std::vector<size_t> &bounds = (run.mType == cmp::kInsert) ? inLineBounds : inBaseBounds;
+		size_t length = bounds [run.getEnd ()] - bounds [run.mStart];
+
+		switch (run.mType)
+		{
+		case cmp::kKeep:
+
+			kept += length;
+			break;
+
+		case cmp::kRemove:
+
+			appendEdit (outEdits, '=', kept);
+			appendEdit (outEdits, '-', length);
+			kept = 0;
+			break;
+
+		case cmp::kInsert:
+
+			appendEdit (outEdits, '=', kept);
+			appendEdit (outEdits, '+', length, inLineText + inLineBounds [run.mStart]);
+			kept = 0;
+			break;
+
+		default:
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//
+//	class CIntraline
+//
+
+bool
+CIntraline::encode (const CHashedString &inBase, const CHashedString &inLine,
+	EMode inMode, std::string &outEdits)
+{
+	outEdits.clear ();
+
+	const char *base = inBase.data ();
+	const char *line = inLine.data ();
+
+	// Common ends first, most lines change in a single place
+
+	size_t prefix = 0;
+	size_t common = std::min (inBase.size (), inLine.size ());
+
+	while (prefix < common  &&  base [prefix] == line [prefix])
+	{
+		prefix ++;
+	}
+
+	size_t suffix = 0;
+
+	while (suffix < common - prefix  &&
+		base [inBase.size () - 1 - suffix] == line [inLine.size () - 1 - suffix])
+	{
+		suffix ++;
+	}
+
+	const char *middleBase = base + prefix;
+	const char *middleLine = line + prefix;
+
+	size_t baseLength = inBase.size () - prefix - suffix;
+	size_t lineLength = inLine.size () - prefix - suffix;
+
+	appendEdit (outEdits, '=', prefix);
+
+	bool done = false;
+
+	if (baseLength != 0  &&  lineLength != 0  &&  baseLength <= kMaxCells / lineLength)
+	{
+		std::string edits;
+
+		if (inMode == kModeChar)
+		{
+			std::vector<size_t> baseBounds (baseLength + 1), lineBounds (lineLength + 1);
+
+			for (size_t i = 0; i < baseBounds.size (); i++) baseBounds [i] = i;
+			for (size_t i = 0; i < lineBounds.size (); i++) lineBounds [i] = i;
+
+			cmp::CDataSource<const char> baseUnits (middleBase, baseLength);
+			cmp::CDataSource<const char> lineUnits (middleLine, lineLength);
+
+			done = diffUnits (&baseUnits, &lineUnits, baseBounds, lineBounds, middleLine, edits);
+		}
+		else
+		{
+			std::vector<size_t> baseBounds, lineBounds;
+
+			splitWords (middleBase, baseLength, baseBounds);
+			splitWords (middleLine, lineLength, lineBounds);
+
+			std::vector<CHashedString> baseWords, lineWords;
+
+			for (size_t i = 0; i + 1 < baseBounds.size (); i++)
+			{
+				baseWords.emplace_back (middleBase + baseBounds [i], baseBounds [i + 1] - baseBounds [i]);
+			}
+
+			for (size_t i = 0; i + 1 < lineBounds.size (); i++)
+			{
+				lineWords.emplace_back (middleLine + lineBounds [i], lineBounds [i + 1] - lineBounds [i]);
+			}
+
+			cmp::CDataSource<const CHashedString> baseUnits (baseWords.data (), baseWords.size ());
+			cmp::CDataSource<const CHashedString> lineUnits (lineWords.data (), lineWords.size ());
+
+			done = diffUnits (&baseUnits, &lineUnits, baseBounds, lineBounds, middleLine, edits);
+		}
+
+		if (done)
+		{
+			outEdits += edits;
+		}
+	}
+
+	if (! done)
+	{
+		appendEdit (outEdits, '-', baseLength);
+		appendEdit (outEdits, '+', lineLength, middleLine);
+	}
+
+	// Worth it only if shorter, and only if it gives the line back. Trailing
+	// '\r' is cut off when the changeset is read, the edits would lose it
+
+	if (outEdits.size () >= inLine.size ()  ||  (! outEdits.empty ()  &&  outEdits.back () == '\r'))
+	{
+		return false;
+	}
+
+	std::string check;
+	decode (inBase, outEdits.data (), outEdits.size (), check);
+
+	return check.size () == inLine.size ()  &&  memcmp (check.data (), line, check.size ()) == 0;
+}
+
+
+void
+CIntraline::decode (const CHashedString &inBase, const char *inEdits, size_t inLength,
+	std::string &outLine)
+{
+	outLine.clear ();
+
+	const char *end = inEdits + inLength;
+	size_t position = 0;
+
+	while (inEdits < end)
+	{
+		char op = *inEdits ++;
+
+		THROW_IF_WINFO (op != '='  &&  op != '-'  &&  op != '+', XBadDiff, "Bad intraline edit");
+		THROW_IF_WINFO (inEdits == end  ||  ! isdigit ((unsigned char) *inEdits), XBadDiff, "Bad intraline edit");
+
+		size_t length = 0;
+
+		while (inEdits < end  &&  isdigit ((unsigned char) *inEdits))
+		{
+			THROW_IF_WINFO (length > (inBase.size () + inLength) / 10, XBadDiff, "Bad intraline edit");
+			length = length * 10 + (*inEdits ++ - '0');
+		}
+
+		if (op == '+')
+		{
+			THROW_IF_WINFO (inEdits == end  ||  *inEdits != ':'  ||  length > (size_t) (end - inEdits - 1),
+				XBadDiff, "Bad intraline insertion");
+
+			outLine.append (inEdits + 1, length);
+			inEdits += length + 1;
+		}
+		else
+		{
+			THROW_IF_WINFO (length > inBase.size () - position, XBadDiff, "Intraline edit beyond the line");
+
+			if (op == '=')
+			{
+				outLine.append (inBase, position, length);
+			}
+
+			position += length;
+		}
+	}
+
+	outLine.append (inBase, position, std::string::npos);
+}
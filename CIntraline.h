@@ -0,0 +1,56 @@
+#ifndef __CIntraline_h
+#define __CIntraline_h
+
+#include <string>
+
+#include "CDataSourceTextFile.h"
+
+
+//
+//	class CIntraline
+//
+//	Edits turning one line into another, for replaced lines that mostly stay
+//	the same. The edits are written as a "~ " changeset line in place of the
+//	"> " one:
+//
+//		=N		keep N bytes of the base line
+//		-N		skip N bytes of it
+//		+N:text	insert the N bytes following ':'
+//
+//	The rest of the base line is kept, so a bare "~" copies it
+//
+
+class CIntraline
+{
+public:
+
+	enum EMode
+	{
+		kModeNone = 0,
+		kModeWord,		// words, whitespace runs and punctuation are the units
+		kModeChar
+	};
+
+	// Edits of inLine against inBase if they are shorter than inLine itself
+
+	static bool encode (const CHashedString &inBase, const CHashedString &inLine,
+		EMode inMode, std::string &outEdits);
+
+	// Apply edits, throws XBadDiff if they don't fit the base line
+
+	static void decode (const CHashedString &inBase, const char *inEdits, size_t inLength,
+		std::string &outLine);
+
+	// Middles of the lines bigger than this are replaced as a whole
+	static const size_t kMaxCells = 64 * 1024;
+
+protected:
+
+	// prevent compiler autogeneration
+	CIntraline ();
+	CIntraline (const CIntraline &);
+	CIntraline &operator= (const CIntraline &);
+};
+
+
+#endif	// __CIntraline_h
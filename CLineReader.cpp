@@ -0,0 +1,493 @@
+#include "stdafx.h"
+
+#include "CLineReader.h"
+#include "CFrameCodec.h"
+
+#include <string.h>
+#include <system_error>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LINE_READER_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+	#define LINE_READER_AVX2 1
+	#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+
+// Index of the lowest set bit, mask must be non-zero
+
+static inline unsigned
+lowestBit (unsigned inMask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward (&index, inMask);
+	return index;
+#else
+	return __builtin_ctz (inMask);
+#endif
+}
+
+
+//
+//	class CLineReader
+//
+
+CLineReader::CLineReader (FILE *inFile, bool inReadAhead, size_t inBlockSize) :
+	mFile (inFile),
+	mMemory (NULL),
+	mBlockSize (inBlockSize),
+	mBuffer (inBlockSize),
+	mBegin (0),
+	mEnd (0),
+	mScanned (0),
+	mEof (false),
+	mDetect (false),
+	mCompressed (false),
+	mReadAhead (inReadAhead),
+	mStop (false)
+{
+	THROW_IF_NULL (mFile);
+	THROW_IF (inBlockSize == 0, XBadParameter);
+}
+
+
+CLineReader::CLineReader (const char *inData, size_t inLength) :
+	mFile (NULL),
+	mMemory ((inData != NULL) ? inData : ""),
+	mBlockSize (0),
+	mBegin (0),
+	mEnd (inLength),
+	mScanned (0),
+	mEof (true),
+	mDetect (false),
+	mCompressed (false),
+	mReadAhead (false),
+	mStop (false)
+{
+	THROW_IF (inData == NULL  &&  inLength != 0, XBadParameter);
+}
+
+
+CLineReader::~CLineReader ()
+{
+	stopReadAhead ();
+}
+
+
+void
+CLineReader::acceptCompressed ()
+{
+	if (mMemory == NULL)
+	{
+		mDetect = true;
+	}
+	else if (CFrameCodec::isCompressed (mMemory + mBegin, mEnd - mBegin))
+	{
+		mDecoded.clear ();
+		CFrameCodec::decode (mMemory + mBegin, mEnd - mBegin, mDecoded);
+
+		mMemory = mDecoded.c_str ();
+		mBegin = 0;
+		mEnd = mDecoded.size ();
+	}
+}
+
+
+void
+CLineReader::startReadAhead ()
+{
+	try
+	{
+		mThread = std::thread (&CLineReader::readAhead, this);
+	}
+	catch (const std::system_error &)
+	{
+		// No threads available, keep reading synchronously
+
+		mReadAhead = false;
+	}
+}
+
+
+void
+CLineReader::stopReadAhead ()
+{
+	if (mThread.joinable ())
+	{
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			mStop = true;
+		}
+
+		mCondition.notify_all ();
+		mThread.join ();
+	}
+}
+
+
+// Read-ahead thread body, the only place touching mFile once started
+
+void
+CLineReader::readAhead ()
+{
+	for (;;)
+	{
+		CBlock block;
+
+		{
+			std::unique_lock<std::mutex> lock (mMutex);
+
+			mCondition.wait (lock, [this] { return mStop  ||  mReady.size () < kReadAheadDepth; });
+
+			if (mStop)
+			{
+				return;
+			}
+
+			if (! mSpare.empty ())
+			{
+				block.mData.swap (mSpare.back ());
+				mSpare.pop_back ();
+			}
+		}
+
+		block.mData.resize (kHeadroom + mBlockSize);
+		block.mLength = fread (&block.mData [kHeadroom], 1, mBlockSize, mFile);
+		block.mError = (block.mLength == 0  &&  ferror (mFile));
+
+		bool done = (block.mLength == 0);
+
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			mReady.push_back (std::move (block));
+		}
+
+		mCondition.notify_all ();
+
+		if (done)
+		{
+			return;
+		}
+	}
+}
+
+
+const char *
+CLineReader::findNewLine (const char *inBegin, const char *inEnd)
+{
+	const char *p = inBegin;
+
+#if LINE_READER_AVX2
+	const __m256i nl32 = _mm256_set1_epi8 ('\n');
+
+	for (; p + 32 <= inEnd; p += 32)
+	{
+		__m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (p));
+		unsigned mask = (unsigned) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, nl32));
+
+		if (mask != 0)
+		{
+			return p + lowestBit (mask);
+		}
+	}
+#endif
+
+#if LINE_READER_SSE2
+	const __m128i nl16 = _mm_set1_epi8 ('\n');
+
+	for (; p + 16 <= inEnd; p += 16)
+	{
+		__m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (p));
+		unsigned mask = (unsigned) _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, nl16));
+
+		if (mask != 0)
+		{
+			return p + lowestBit (mask);
+		}
+	}
+#endif
+
+	// Tail or no SIMD at all
+
+	const void *found = memchr (p, '\n', inEnd - p);
+
+	return (found != NULL) ? static_cast<const char *> (found) : inEnd;
+}
+
+
+bool
+CLineReader::fillBuffer ()
+{
+	if (mEof)
+	{
+		return false;
+	}
+
+	if (mThread.joinable ())
+	{
+		return fillBufferAhead ();
+	}
+
+	// Move unconsumed tail to the buffer start, grow buffer if the tail fills it
+
+	size_t tail = mEnd - mBegin;
+
+	if (mBegin > 0  &&  tail > 0)
+	{
+		memmove (&mBuffer [0], &mBuffer [mBegin], tail);
+	}
+
+	mBegin = 0;
+	mEnd = tail;
+
+	if (mDetect)
+	{
+		// Nothing is consumed yet, a plain file keeps what was peeked
+
+		mDetect = false;
+
+		size_t n = fread (&mBuffer [mEnd], 1, CFrameCodec::kMagicSize, mFile);
+
+		THROW_IF (n == 0  &&  ferror (mFile), XCantRead);
+
+		if (CFrameCodec::isCompressed (&mBuffer [mEnd], n))
+		{
+			mCompressed = true;
+		}
+		else
+		{
+			mEnd += n;
+		}
+	}
+
+	if (mCompressed)
+	{
+		return fillBufferFrame ();
+	}
+
+	if (mEnd == mBuffer.size ())
+	{
+		mBuffer.resize (mBuffer.size () * 2);
+	}
+
+	size_t request = mBuffer.size () - mEnd;
+	size_t n = fread (&mBuffer [mEnd], 1, request, mFile);
+
+	if (n == 0)
+	{
+		THROW_IF (ferror (mFile), XCantRead);
+		mEof = true;
+
+		return false;
+	}
+
+	mEnd += n;
+
+	// File turned out to be longer than a block, continue in background
+
+	if (n == request  &&  mReadAhead)
+	{
+		startReadAhead ();
+	}
+
+	return true;
+}
+
+
+bool
+CLineReader::fillBufferFrame ()
+{
+	char header [CFrameCodec::kHeaderSize];
+
+	size_t n = fread (header, 1, sizeof (header), mFile);
+
+	THROW_IF (n == 0  &&  ferror (mFile), XCantRead);
+	THROW_IF_WINFO (n != sizeof (header), XCantDecode, "Truncated compressed stream");
+
+	size_t raw, payload;
+
+	CFrameCodec::readHeader (header, &raw, &payload);
+
+	if (raw == 0)
+	{
+		mEof = true;
+		return false;
+	}
+
+	mFrame.resize (payload);
+
+	n = fread (mFrame.data (), 1, payload, mFile);
+
+	THROW_IF (n != payload  &&  ferror (mFile), XCantRead);
+	THROW_IF_WINFO (n != payload, XCantDecode, "Truncated frame");
+
+	if (mBuffer.size () < mEnd + raw)
+	{
+		mBuffer.resize (mEnd + raw);
+	}
+
+	CFrameCodec::decodeFrame (header, mFrame.data (), &mBuffer [mEnd]);
+	mEnd += raw;
+
+	return true;
+}
+
+
+bool
+CLineReader::fillBufferAhead ()
+{
+	CBlock block;
+
+	{
+		std::unique_lock<std::mutex> lock (mMutex);
+
+		mCondition.wait (lock, [this] { return ! mReady.empty (); });
+
+		block = std::move (mReady.front ());
+		mReady.pop_front ();
+	}
+
+	mCondition.notify_all ();
+
+	THROW_IF (block.mError, XCantRead);
+
+	if (block.mLength == 0)
+	{
+		mEof = true;
+		return false;
+	}
+
+	// Put the unconsumed tail right in front of the new data
+
+	size_t tail = mEnd - mBegin;
+
+	if (tail <= kHeadroom)
+	{
+		if (tail > 0)
+		{
+			memcpy (&block.mData [kHeadroom - tail], &mBuffer [mBegin], tail);
+		}
+
+		mBegin = kHeadroom - tail;
+		mEnd = kHeadroom + block.mLength;
+	}
+	else
+	{
+		// Very long line, join it the slow way
+
+		std::vector<char> joined (tail + block.mLength);
+
+		memcpy (&joined [0], &mBuffer [mBegin], tail);
+		memcpy (&joined [tail], &block.mData [kHeadroom], block.mLength);
+
+		block.mData.swap (joined);
+
+		mBegin = 0;
+		mEnd = block.mData.size ();
+	}
+
+	mBuffer.swap (block.mData);
+
+	// Hand the consumed buffer back to the read-ahead thread
+
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		mSpare.push_back (std::move (block.mData));
+	}
+
+	return true;
+}
+
+
+bool
+CLineReader::readLine (const char **outData, size_t *outLength)
+{
+	if (mMemory != NULL)
+	{
+		return readMemoryLine (outData, outLength);
+	}
+
+	for (;;)
+	{
+		const char *base = mBuffer.data ();
+		const char *end = base + mEnd;
+		const char *line = base + mBegin;
+		const char *nl = findNewLine (line + mScanned, end);
+
+		size_t len;
+
+		if (nl != end)
+		{
+			len = nl - line;
+			mBegin += len + 1;
+		}
+		else if (! fillBuffer ())
+		{
+			// Last line may have no line ending
+
+			if (mBegin == mEnd)
+			{
+				return false;
+			}
+
+			line = mBuffer.data () + mBegin;
+			len = mEnd - mBegin;
+			mBegin = mEnd;
+		}
+		else
+		{
+			// Tail has no '\n', continue after it within refilled buffer
+
+			mScanned = (end - line);
+			continue;
+		}
+
+		mScanned = 0;
+
+		while (len > 0  &&  line [len - 1] == '\r')
+		{
+			len --;
+		}
+
+		*outData = line;
+		*outLength = len;
+
+		return true;
+	}
+}
+
+
+bool
+CLineReader::readMemoryLine (const char **outData, size_t *outLength)
+{
+	if (mBegin == mEnd)
+	{
+		return false;
+	}
+
+	const char *line = mMemory + mBegin;
+	const char *end = mMemory + mEnd;
+	const char *nl = findNewLine (line, end);
+
+	size_t len = nl - line;
+
+	mBegin += (nl != end) ? len + 1 : len;
+
+	while (len > 0  &&  line [len - 1] == '\r')
+	{
+		len --;
+	}
+
+	*outData = line;
+	*outLength = len;
+
+	return true;
+}
@@ -0,0 +1,134 @@
+#ifndef __CLineReader_h
+#define __CLineReader_h
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "XExceptions.h"
+
+
+//
+//	class CLineReader
+//
+//	Splits a file into lines reading it by large blocks. Line length is not limited,
+//	a line crossing the block boundary is kept whole. The newline search is vectorised
+//	(SSE2, or AVX2 when the compiler targets it), trailing '\r' characters are dropped
+//	so both "\n" and "\r\n" line endings are handled.
+//
+//	With read-ahead enabled a file longer than one block is read by a background
+//	thread, so the caller splits and hashes a block while the next ones are loading.
+//
+//	A memory buffer is split in place, returned lines point into it.
+//
+//	Compressed input (see CFrameCodec) may be accepted, it is recognised by
+//	its magic and decoded a frame at a time, a buffer is decoded at once
+//
+
+class CLineReader
+{
+public:
+
+	static const size_t kDefaultBlockSize = 1024 * 1024;
+
+	explicit CLineReader (FILE *inFile, bool inReadAhead = false,
+		size_t inBlockSize = kDefaultBlockSize);
+
+	// Buffer must outlive the reader
+
+	CLineReader (const char *inData, size_t inLength);
+
+	virtual ~CLineReader ();
+
+	// Fetch next line without its line ending. Returned data stays valid until
+	// the next call, false means there are no more lines
+
+	bool readLine (const char **outData, size_t *outLength);
+
+	// Decode compressed input if it is, call before the first readLine ()
+
+	void acceptCompressed ();
+
+	// Locate first '\n' within [inBegin, inEnd), returns inEnd if there is none
+
+	static const char *findNewLine (const char *inBegin, const char *inEnd);
+
+protected:
+
+	// prevent compiler autogeneration
+	CLineReader ();
+	CLineReader (const CLineReader &);
+	CLineReader &operator= (const CLineReader &);
+
+	// Read next block keeping the unconsumed tail, false on end of file
+
+	bool fillBuffer ();
+
+	// readLine () of a memory buffer
+
+	bool readMemoryLine (const char **outData, size_t *outLength);
+
+	// Same for frames of compressed input
+
+	bool fillBufferFrame ();
+
+	// Same for blocks loaded by the read-ahead thread
+
+	bool fillBufferAhead ();
+
+	void startReadAhead ();
+	void stopReadAhead ();
+
+	// Read-ahead thread body
+
+	void readAhead ();
+
+	// Block loaded by the read-ahead thread, data starts at kHeadroom
+	// offset leaving space for the previous block tail
+
+	struct CBlock
+	{
+		std::vector<char> mData;
+		size_t mLength;
+		bool mError;
+	};
+
+	static const size_t kHeadroom = 64 * 1024;
+	static const size_t kReadAheadDepth = 4;
+
+	FILE *mFile;
+
+	const char *mMemory;	// buffer split in place, NULL for a file
+
+	size_t mBlockSize;
+
+	std::vector<char> mBuffer;
+
+	size_t mBegin;		// start of unconsumed data
+	size_t mEnd;		// end of valid data
+	size_t mScanned;	// bytes after mBegin known to have no '\n'
+
+	bool mEof;
+
+	bool mDetect;		// first block is checked for the compressed stream magic
+	bool mCompressed;	// blocks are compressed frames
+
+	std::vector<char> mFrame;	// payload of the frame being decoded
+	std::string mDecoded;		// decoded memory buffer
+
+	bool mReadAhead;	// read-ahead is allowed
+	bool mStop;			// read-ahead thread must quit
+
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+
+	std::deque<CBlock> mReady;					// blocks read ahead
+	std::vector<std::vector<char> > mSpare;		// consumed blocks for reuse
+};
+
+
+#endif	// __CLineReader_h
@@ -0,0 +1,286 @@
+#include "stdafx.h"
+
+#include "COutputWriter.h"
+#include "CFrameCodec.h"
+#include "CStats.h"
+
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+#if !defined(_WIN32)
+	#include <unistd.h>
+	#include <sys/uio.h>
+#endif
+
+
+//
+//	class COutputWriter
+//
+
+COutputWriter::COutputWriter (FILE *inFile, size_t inBufferSize) :
+	mFile (inFile),
+	mFd (-1),
+	mString (NULL),
+	mBuffer (inBufferSize),
+	mUsed (0),
+	mCompress (false),
+	mStarted (false),
+	mBytesWritten (0)
+{
+	THROW_IF_NULL (mFile);
+	THROW_IF (inBufferSize == 0, XBadParameter);
+
+	mSegments.reserve (kMaxSegments);
+
+#if !defined(_WIN32)
+	// Whatever went through stdio must precede our output
+
+	THROW_IF (fflush (mFile) == EOF, XCantWrite);
+	mFd = fileno (mFile);
+#endif
+}
+
+
+COutputWriter::COutputWriter (std::string *outString, size_t inBufferSize) :
+	mFile (NULL),
+	mFd (-1),
+	mString (outString),
+	mBuffer (inBufferSize),
+	mUsed (0),
+	mCompress (false),
+	mStarted (false),
+	mBytesWritten (0)
+{
+	THROW_IF_NULL (mString);
+	THROW_IF (inBufferSize == 0, XBadParameter);
+
+	mSegments.reserve (kMaxSegments);
+}
+
+
+COutputWriter::~COutputWriter ()
+{
+	XTRY
+	{
+		flush ();
+	}
+	XEND
+}
+
+
+void
+COutputWriter::addSegment (const char *inData, size_t inLength)
+{
+	if (! mSegments.empty ())
+	{
+		CSegment &last = mSegments.back ();
+
+		if (last.mData + last.mLength == inData)
+		{
+			last.mLength += inLength;
+			return;
+		}
+	}
+
+	CSegment segment = { inData, inLength };
+	mSegments.push_back (segment);
+}
+
+
+void
+COutputWriter::write (const char *inData, size_t inLength)
+{
+	while (inLength > 0)
+	{
+		if (mUsed == mBuffer.size ()  ||  mSegments.size () == kMaxSegments)
+		{
+			flush ();
+		}
+
+		size_t n = std::min (inLength, mBuffer.size () - mUsed);
+		char *dest = &mBuffer [mUsed];
+
+		memcpy (dest, inData, n);
+		mUsed += n;
+
+		addSegment (dest, n);
+
+		inData += n;
+		inLength -= n;
+	}
+}
+
+
+void
+COutputWriter::write (char inChar)
+{
+	write (&inChar, 1);
+}
+
+
+void
+COutputWriter::writeRef (const char *inData, size_t inLength)
+{
+	if (inLength < kReferenceThreshold)
+	{
+		write (inData, inLength);
+	}
+	else
+	{
+		if (mSegments.size () == kMaxSegments)
+		{
+			flush ();
+		}
+
+		addSegment (inData, inLength);
+	}
+}
+
+
+void
+COutputWriter::setCompression (bool inCompress)
+{
+	THROW_IF (mStarted  ||  ! mSegments.empty (), XBadState);
+
+	mCompress = inCompress;
+}
+
+
+void
+COutputWriter::flush ()
+{
+	if (mCompress  &&  ! mSegments.empty ())
+	{
+		// Pending pieces become a single frame
+
+		mFrame.clear ();
+
+		for (const CSegment &segment : mSegments)
+		{
+			mFrame.append (segment.mData, segment.mLength);
+		}
+
+		mPacked.clear ();
+
+		if (! mStarted)
+		{
+			CFrameCodec::writeMagic (mPacked);
+			mStarted = true;
+		}
+
+		CFrameCodec::encode (mFrame.data (), mFrame.size (), mPacked);
+
+		mSegments.clear ();
+		addSegment (mPacked.data (), mPacked.size ());
+	}
+
+	if (! mSegments.empty ())
+	{
+		writeSegments ();
+	}
+
+	mSegments.clear ();
+	mUsed = 0;
+}
+
+
+void
+COutputWriter::finish ()
+{
+	flush ();
+
+	if (mCompress)
+	{
+		mPacked.clear ();
+
+		if (! mStarted)
+		{
+			CFrameCodec::writeMagic (mPacked);
+			mStarted = true;
+		}
+
+		CFrameCodec::writeEnd (mPacked);
+
+		addSegment (mPacked.data (), mPacked.size ());
+		writeSegments ();
+
+		mSegments.clear ();
+		mCompress = false;
+	}
+}
+
+
+void
+COutputWriter::writeSegments ()
+{
+	STATS_PHASE (kPhaseWrite);
+
+	uint64_t written = mBytesWritten;
+
+	if (mString != NULL)
+	{
+		for (const CSegment &segment : mSegments)
+		{
+			mString->append (segment.mData, segment.mLength);
+			mBytesWritten += segment.mLength;
+		}
+		STATS_COUNT (kBytesWritten, mBytesWritten - written);
+
+		return;
+	}
+
+#if defined(_WIN32)
+
+	for (const CSegment &segment : mSegments)
+	{
+		THROW_IF (fwrite (segment.mData, 1, segment.mLength, mFile) != segment.mLength, XCantWrite);
+		mBytesWritten += segment.mLength;
+	}
+
+#else
+
+	size_t first = 0;
+	size_t count = mSegments.size ();
+
+	std::vector<iovec> iov (count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		iov [i].iov_base = const_cast<char *> (mSegments [i].mData);
+		iov [i].iov_len = mSegments [i].mLength;
+	}
+
+	while (first < count)
+	{
+		ssize_t n = writev (mFd, &iov [first], (int) (count - first));
+
+		if (n < 0)
+		{
+			THROW_IF (errno != EINTR, XCantWrite);
+			continue;
+		}
+
+		mBytesWritten += n;
+
+		// Skip fully written segments, advance within the partial one
+
+		size_t done = (size_t) n;
+
+		while (first < count  &&  done >= iov [first].iov_len)
+		{
+			done -= iov [first].iov_len;
+			first ++;
+		}
+
+		if (first < count)
+		{
+			iov [first].iov_base = static_cast<char *> (iov [first].iov_base) + done;
+			iov [first].iov_len -= done;
+		}
+	}
+
+#endif
+
+	STATS_COUNT (kBytesWritten, mBytesWritten - written);
+}
@@ -0,0 +1,110 @@
+#ifndef __COutputWriter_h
+#define __COutputWriter_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "XExceptions.h"
+
+
+//
+//	class COutputWriter
+//
+//	Buffered output layer for changesets and apply results. Short pieces are copied
+//	into a large user-space buffer, long ones are only referenced and go to the file
+//	together with the buffered bytes by a single scatter-gather write (writev) call.
+//	Referenced data must stay valid until the next flush (). Output may go to a
+//	string instead of a file, and may be compressed (see CFrameCodec), every
+//	flush () then writes a frame
+//
+
+class COutputWriter
+{
+public:
+
+	static const size_t kDefaultBufferSize = 256 * 1024;
+
+	// Pieces shorter than that are cheaper to copy than to reference
+
+	static const size_t kReferenceThreshold = 128;
+
+	explicit COutputWriter (FILE *inFile, size_t inBufferSize = kDefaultBufferSize);
+
+	// Appends to the string, it must outlive the writer
+
+	explicit COutputWriter (std::string *outString, size_t inBufferSize = kDefaultBufferSize);
+
+	// Flushes pending data, but swallows errors, call flush () to get them
+	virtual ~COutputWriter ();
+
+	// Copy data into the buffer
+
+	void write (const char *inData, size_t inLength);
+	void write (const std::string &inData) { write (inData.data (), inData.size ()); }
+	void write (char inChar);
+
+	// Reference data without copying, it must stay valid until flush ()
+
+	void writeRef (const char *inData, size_t inLength);
+	void writeRef (const std::string &inData) { writeRef (inData.data (), inData.size ()); }
+
+	// Compress the output, must be set before anything is written
+
+	void setCompression (bool inCompress);
+
+	// Write everything pending to the file
+
+	void flush ();
+
+	// Flush and end the output, compressed streams get their end mark
+
+	void finish ();
+
+	uint64_t getBytesWritten () const { return mBytesWritten; }
+
+protected:
+
+	// prevent compiler autogeneration
+	COutputWriter ();
+	COutputWriter (const COutputWriter &);
+	COutputWriter &operator= (const COutputWriter &);
+
+	struct CSegment
+	{
+		const char *mData;
+		size_t mLength;
+	};
+
+	// Append piece to pending segments merging adjacent ones,
+	// caller makes sure there is room for one more segment
+
+	void addSegment (const char *inData, size_t inLength);
+
+	// Write pending segments to the file
+
+	void writeSegments ();
+
+	static const size_t kMaxSegments = 1024;
+
+	FILE *mFile;
+	int mFd;
+
+	std::string *mString;
+
+	std::vector<char> mBuffer;
+	size_t mUsed;
+
+	std::vector<CSegment> mSegments;
+
+	bool mCompress;
+	bool mStarted;			// compressed stream magic is written
+	std::string mFrame;		// raw bytes of a frame, then the frame
+	std::string mPacked;
+
+	uint64_t mBytesWritten;
+};
+
+
+#endif	// __COutputWriter_h
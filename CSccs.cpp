@@ -0,0 +1,115 @@
+#include "stdafx.h"
+
+#include "CSccs.h"
+
+#include <iomanip>
+
+#include "CChangeSetBuilder.h"
+
+
+//
+//	class CSccs
+//
+
+void
+CSccs::diff (
+	const char *inSource, size_t inSourceLength,
+	const char *inDest, size_t inDestLength,
+	std::string *outChangeSet,
+	const CSccsOptions &inOptions,
+	CSccsDiffInfo *outInfo)
+{
+	THROW_IF_NULL (outChangeSet);
+
+	CDataSourceTextFile source (inSource, inSourceLength);
+	CDataSourceTextFile dest (inDest, inDestLength);
+
+	CChangeSetBuilder set_builder (outChangeSet, source, dest);
+
+	diff (source, dest, set_builder, inOptions, outInfo);
+}
+
+
+void
+CSccs::diff (
+	CDataSourceTextFile &inSource,
+	CDataSourceTextFile &inDest,
+	CChangeSetBuilder &ioBuilder,
+	const CSccsOptions &inOptions,
+	CSccsDiffInfo *outInfo,
+	const char *inSourceName)
+{
+	inSource.setNormalization (inOptions.mNormalization);
+	inDest.setNormalization (inOptions.mNormalization);
+
+	typedef cmp::CCompare<CDataSourceTextFile> CompareT;
+	CompareT compare (&inSource, &inDest);
+
+	compare.setMaxMemory (inOptions.mMaxMemory);
+	compare.setMaxCost (inOptions.mMaxCost);
+	compare.setTimeLimit (inOptions.mTimeout);
+	compare.setThreadPool (inOptions.mPool);
+
+	// The script is pulled run by run, hunks are written while the
+	// rest of it is still being computed
+
+	THROW_IF (! compare.start (), XComparisonFail);
+
+	if (inSource.getSize () == 0)
+	{
+		THROW_WINFO (XEmptySource, (inSourceName != NULL) ? inSourceName : "");
+	}
+
+	ioBuilder.setIntraline (inOptions.mIntraline);
+	ioBuilder.setCompression (inOptions.mCompress);
+	ioBuilder.setFingerprint (inOptions.mFingerprint);
+	ioBuilder.startConstruction ();
+
+	// Loop through the edit script runs and output the differing lines
+
+	cmp::CEditRun run (cmp::kUndefined, 0, 0);
+	bool identity = true;
+
+	while (compare.next (run))
+	{
+		LOG_STR ((run.mType == cmp::kRemove ? " -: " :
+			(run.mType == cmp::kInsert ? " +: " : " =: ")) <<
+			std::setw (6) << run.mStart << std::setw (6) << run.mLength << std::endl);
+
+		identity = identity  &&  run.mType == cmp::kKeep;
+
+		ioBuilder.applyRun (run);
+	}
+
+	if (outInfo != NULL)
+	{
+		outInfo->mStrategy = compare.getStrategy ();
+		outInfo->mAnchors = compare.getAnchorCount ();
+		outInfo->mEdits = compare.getEditCount ();
+		outInfo->mMinEdits = compare.getMinEditCount ();
+	}
+
+	THROW_IF (identity, XFilesIdentical);
+
+	ioBuilder.endConstruction ();
+}
+
+
+void
+CSccs::apply (
+	const char *inSource, size_t inSourceLength,
+	const char *inSet, size_t inSetLength,
+	std::string *outResult,
+	size_t inFuzz,
+	std::vector<CChangeSetProcessor::CFuzzReport> *outFuzz)
+{
+	CChangeSetProcessor set_processor (inSource, inSourceLength, inSet, inSetLength, outResult);
+
+	set_processor.setFuzz (inFuzz);
+	set_processor.process ();
+
+	if (outFuzz != NULL)
+	{
+		*outFuzz = set_processor.getFuzzReport ();
+	}
+}
@@ -0,0 +1,126 @@
+#ifndef __CSccs_h
+#define __CSccs_h
+
+#include <string>
+
+#include "CCompare.h"
+#include "CChangeSetProcessor.h"
+#include "CDataSourceTextFile.h"
+#include "CIntraline.h"
+
+#include "XExceptions.h"
+
+class CChangeSetBuilder;
+class CThreadPool;
+
+//
+// User exceptions declaration part
+//
+
+DECLARE_EXCEPTION(XComparisonFail, XRuntime, "Comparison failed");
+
+DECLARE_EXCEPTION(XEmptySource, XRuntime, "Empty source file");
+DECLARE_EXCEPTION(XFilesIdentical, XRuntime, "Files are identical");
+
+
+//
+//	struct CSccsOptions
+//
+//	Comparison knobs, defaults give the minimal diff within the default budget
+//
+
+struct CSccsOptions
+{
+	CSccsOptions () :
+		mMaxMemory (cmp::kDefaultMaxMemory),
+		mMaxCost (0),
+		mTimeout (0),
+		mNormalization (CHashedString::kNormalizeNone),
+		mIntraline (CIntraline::kModeNone),
+		mCompress (false),
+		mFingerprint (false),
+		mPool (NULL)
+	{
+	}
+
+	size_t mMaxMemory;		// working memory budget of the comparison
+	size_t mMaxCost;		// latency knobs, 0 if unlimited
+	unsigned mTimeout;
+
+	CHashedString::ENormalization mNormalization;	// whitespace differences to ignore
+	CIntraline::EMode mIntraline;					// edits of replaced lines, if any
+
+	bool mCompress;			// write the changeset compressed, apply detects it
+	bool mFingerprint;		// write text fingerprints and hunk lines, see CChangeSetBuilder
+
+	CThreadPool *mPool;		// diffs regions between anchors, may be NULL
+};
+
+
+//
+//	struct CSccsDiffInfo
+//
+//	How the comparison went
+//
+
+struct CSccsDiffInfo
+{
+	cmp::CStrategy mStrategy;
+	size_t mAnchors;
+	size_t mEdits;			// only known with a latency knob set
+	size_t mMinEdits;
+};
+
+
+//
+//	class CSccs
+//
+//	Entry points of the library, both directions work on memory buffers and
+//	never touch the file system. Calls share no state but the process-wide
+//	line hash seed, so they may run concurrently
+//
+
+class CSccs
+{
+public:
+
+	// Append the changeset turning inSource into inDest to outChangeSet
+
+	static void diff (
+		const char *inSource, size_t inSourceLength,
+		const char *inDest, size_t inDestLength,
+		std::string *outChangeSet,
+		const CSccsOptions &inOptions = CSccsOptions (),
+		CSccsDiffInfo *outInfo = NULL);
+
+	// Same for ready data sources and a builder of any sink, inSourceName
+	// only goes to the XEmptySource message
+
+	static void diff (
+		CDataSourceTextFile &inSource,
+		CDataSourceTextFile &inDest,
+		CChangeSetBuilder &ioBuilder,
+		const CSccsOptions &inOptions = CSccsOptions (),
+		CSccsDiffInfo *outInfo = NULL,
+		const char *inSourceName = NULL);
+
+	// Append inSource patched with the changeset to outResult, inFuzz context
+	// lines of a hunk may mismatch, hunks applied that way go to outFuzz
+
+	static void apply (
+		const char *inSource, size_t inSourceLength,
+		const char *inSet, size_t inSetLength,
+		std::string *outResult,
+		size_t inFuzz = 0,
+		std::vector<CChangeSetProcessor::CFuzzReport> *outFuzz = NULL);
+
+protected:
+
+	// prevent compiler autogeneration
+	CSccs ();
+	CSccs (const CSccs &);
+	CSccs &operator= (const CSccs &);
+};
+
+
+#endif	// __CSccs_h
@@ -1,203 +1,676 @@
-#include "stdafx.h"
-
-#include "CSccsApplication.h"
-
-#include <iostream>
-#include <iomanip>
-#include <string>
-
-#include "CCompare.h"
-#include "CDataSourceTextFile.h"
-
-#include "CChangeSetBuilder.h"
-#include "CChangeSetProcessor.h"
-
-
-//
-//	class CSccsApplication
-//
-
-CSccsApplication::CSccsApplication (int argc, char *argv []) :
-		CApplication (argc, argv),
-	mApply (false),
-	mFile1 (NULL),
-	mFile2 (NULL),
-	mFileDiff (NULL)
-{
-}
-
-
-CSccsApplication::~CSccsApplication ()
-{
-}
-
-
-void
-CSccsApplication::checkOption (const char *inOption)
-{
-	THROW_IF (strcmpi (inOption, "/apply"), XIllegalUsage);
-
-	mApply = true;
-}
-
-
-void
-CSccsApplication::outputUsage ()
-{
-	std::cout << "Usage 1:" << std::endl <<
-		mArgv[0] << " input_file_1 input_file_2 changeset_file" << std::endl << std::endl <<
-		"Usage 2:" << std::endl <<
-		mArgv[0] << " input_file output_file changeset_file /apply" << std::endl << std::endl;
-}
-
-
-void
-CSccsApplication::initialize ()
-{
-	// Here we have setted working mode, just check for proper arguments number/positions
-	
-	THROW_IF ((mApply) ? (mFirstKey != 4) : 
-		(mFirstKey != 0  ||  mArgc != 4), XIllegalUsage);
-	
-	mFile1Name = mArgv [1];
-	mFile2Name = mArgv [2];
-	mFileDiffName = mArgv [3];
-
-    mFile1 = fopen (mFile1Name.c_str (), "r");
-	THROW_IF_NOT_WINFO (mFile1, XCantOpen, mFile1Name.c_str());
-	
-	mFile2 = fopen (mFile2Name.c_str (), (mApply) ? "w" : "r");
-	THROW_IF_NOT_WINFO (mFile2, XCantOpen, mFile2Name.c_str());
-	
-	mFileDiff = fopen (mFileDiffName.c_str (), (mApply) ? "r" : "w");
-	THROW_IF_NOT_WINFO (mFileDiff, XCantOpen, mFileDiffName.c_str ());
-}
-
-
-void
-CSccsApplication::destroy ()
-{
-	// Clean up properly, close opened files & whatever
-	
-	if (mFile1 != NULL)
-	{
-		fclose (mFile1);
-		mFile1 = NULL;
-	}
-	
-	if (mFile2 != NULL)
-	{
-		fclose (mFile2);
-		mFile2 = NULL;
-
-		if (mReturnCode != RC_OK  &&  mApply)
-		{
-			// Output file generation failed, delete it
-			
-			unlink (mFile2Name.c_str ());
-		}
-	}
-	
-	if (mFileDiff != NULL)
-	{
-		fclose (mFileDiff);
-		mFileDiff = NULL;
-		
-		if (mReturnCode != RC_OK  &&  ! mApply)
-		{
-			// Changeset file generation failed, delete it
-			
-			unlink (mFileDiffName.c_str ());
-		}
-	}
-}
-
-
-void
-CSccsApplication::execute ()
-{
-//	cmp::testCharacterDiff ("abceghj", "abdbfehj");	// quick algo test
-
-	if (mApply)
-	{
-		// Generate output file basing on changeset diff
-		
-		CChangeSetProcessor set_processor (mFile1, mFile2, mFileDiff);
-
-		set_processor.process ();
-	}
-	else
-	{
-		// Generate changeset diff file basing on two reference input files
-		
-        // instantiate two text file data sources;one for each file
-
-		CDataSourceTextFile compare_data1 (mFile1);
-        CDataSourceTextFile compare_data2 (mFile2);
-		
-        // We need to instantiate a template compare object,
-        // create a typedef first so that we can use a short-handed
-        // version later
-
-		typedef cmp::CCompare<CDataSourceTextFile> CompareT;
-        CompareT compare (&compare_data1, &compare_data2);
-		
-        int lcs;
-        CompareT::CResultSet seq;
-		
-        // Process the data sources
-        
-		THROW_IF ((lcs = compare.process (&seq)) == -1, XComparisonFail);
-		
-		if (compare_data1.getSize () == 0)
-		{
-			THROW_WINFO (XEmptySource, mFile1Name.c_str());
-		}
-        else
-        {
-			CChangeSetBuilder set_builder (mFileDiff, compare_data1, compare_data2);
-			
-			set_builder.startConstruction ();
-
-			// Loop through the result set and output the differing lines
-			auto it  = seq.begin();
-			auto ite = seq.end();
-			
-			bool b_identical = true;
-			int line = 1;
-
-			for (; it != ite; ++it)
-			{
-				auto res = *it;
-
-				if (res->type () == cmp::kRemove)
-				{
-					LOG_STR (" -: ");
-
-					set_builder.deleteLine (res->recNum () - 1);
-					b_identical = false;
-				}
-				else if (res->type () == cmp::kInsert)
-				{
-					LOG_STR (" +: ");
-
-					set_builder.insertLine (res->recNum () - 1);
-					b_identical = false;
-				}
-				else
-				{
-					LOG_STR (" =: ");
-
-					set_builder.skipLine ();
-				}
-				
-				LOG_STR (std::setw (4) << res->recNum () << std::setw (4) <<
-					line ++ << res->data().c_str() << std::endl);
-			}
-			
-	        THROW_IF (b_identical, XFilesIdentical);
-			
-			set_builder.endConstruction ();
-		}
-	}
-}
+#include "stdafx.h"
+
+#include "CSccsApplication.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <ctype.h>
+
+#include "CChangeSetBuilder.h"
+#include "CChangeSetProcessor.h"
+#include "CSccsServer.h"
+#include "CThreadPool.h"
+
+
+// Byte count with optional K, M or G suffix, throws on garbage
+
+static size_t
+parseSize (const char *inValue)
+{
+	char *end;
+	unsigned long long value = strtoull (inValue, &end, 10);
+
+	THROW_IF (end == inValue, XIllegalUsage);
+
+	switch (toupper ((unsigned char) *end))
+	{
+	case 'G':	value <<= 10;	// fall through
+	case 'M':	value <<= 10;	// fall through
+	case 'K':	value <<= 10;	end ++;		break;
+	}
+
+	THROW_IF (*end != '\0'  &&  toupper ((unsigned char) *end) != 'B', XIllegalUsage);
+	THROW_IF (value == 0  ||  value > (size_t) -1, XIllegalUsage);
+
+	return (size_t) value;
+}
+
+
+//
+//	class CSccsApplication
+//
+
+CSccsApplication::CSccsApplication (int argc, char *argv []) :
+		CApplication (argc, argv),
+	mApply (false),
+	mCheck (false),
+	mHashStats (false),
+	mMaxMemory (cmp::kDefaultMaxMemory),
+	mMaxMemoryGiven (false),
+	mMaxCost (0),
+	mTimeout (0),
+	mThreads (0),
+	mNormalization (CHashedString::kNormalizeNone),
+	mIntraline (CIntraline::kModeNone),
+	mCompress (false),
+	mFingerprint (false),
+	mFuzz (0),
+	mStatsJson (false),
+	mFile1 (NULL),
+	mFile2 (NULL),
+	mFileDiff (NULL)
+{
+}
+
+
+CSccsApplication::~CSccsApplication ()
+{
+}
+
+
+void
+CSccsApplication::checkOption (const char *inOption)
+{
+	const char *value;
+
+	if (strcmpi (inOption, "/apply") == 0)
+	{
+		mApply = true;
+	}
+	else if (strcmpi (inOption, "/check") == 0)
+	{
+		mCheck = true;
+	}
+	else if (strcmpi (inOption, "/hashstats") == 0)
+	{
+		mHashStats = true;
+		CHashedString::enableStats (true);
+	}
+	else if ((value = getOptionValue (inOption, "/maxmem")) != NULL)
+	{
+		mMaxMemory = parseSize (value);
+		mMaxMemoryGiven = true;
+	}
+	else if ((value = getOptionValue (inOption, "/maxcost")) != NULL)
+	{
+		mMaxCost = strtoul (value, NULL, 10);
+		THROW_IF (mMaxCost == 0, XIllegalUsage);
+	}
+	else if ((value = getOptionValue (inOption, "/timeout")) != NULL)
+	{
+		mTimeout = strtoul (value, NULL, 10);
+		THROW_IF (mTimeout == 0, XIllegalUsage);
+	}
+	else if ((value = getOptionValue (inOption, "/threads")) != NULL)
+	{
+		mThreads = strtoul (value, NULL, 10);
+		THROW_IF (mThreads == 0, XIllegalUsage);
+	}
+	else if ((value = getOptionValue (inOption, "/whitespace")) != NULL)
+	{
+		if (strcmpi (value, "trailing") == 0)
+		{
+			mNormalization = CHashedString::kNormalizeTrailing;
+		}
+		else if (strcmpi (value, "change") == 0)
+		{
+			mNormalization = CHashedString::kNormalizeSpace;
+		}
+		else THROW (XIllegalUsage);
+	}
+	else if (strcmpi (inOption, "/intraline") == 0  ||  strnicmp (inOption, "/intraline:", 11) == 0)
+	{
+		const char *unit = getOptionValue (inOption, "/intraline");
+
+		if (unit == NULL  ||  strcmpi (unit, "word") == 0)
+		{
+			mIntraline = CIntraline::kModeWord;
+		}
+		else if (strcmpi (unit, "char") == 0)
+		{
+			mIntraline = CIntraline::kModeChar;
+		}
+		else THROW (XIllegalUsage);
+	}
+	else if (strcmpi (inOption, "/compress") == 0)
+	{
+		mCompress = true;
+	}
+	else if (strcmpi (inOption, "/fingerprint") == 0)
+	{
+		mFingerprint = true;
+	}
+	else if ((value = getOptionValue (inOption, "/fuzz")) != NULL)
+	{
+		char *end;
+		mFuzz = strtoul (value, &end, 10);
+		THROW_IF (end == value  ||  *end != '\0', XIllegalUsage);
+	}
+	else if ((value = getOptionValue (inOption, "/server")) != NULL)
+	{
+		mServerPath = value;
+		THROW_IF (mServerPath.empty (), XIllegalUsage);
+	}
+	else if (strcmpi (inOption, "/stats") == 0  ||  strnicmp (inOption, "/stats:", 7) == 0)
+	{
+		const char *format = getOptionValue (inOption, "/stats");
+
+		THROW_IF (format != NULL  &&  strcmpi (format, "json") != 0  &&  strcmpi (format, "text") != 0, XIllegalUsage);
+
+		mStatsJson = (format != NULL  &&  strcmpi (format, "json") == 0);
+
+		if (! mStats)
+		{
+			mStats.reset (new CStats ());
+			CStats::install (mStats.get ());
+		}
+
+		CHashedString::enableStats (true);
+	}
+	else THROW (XIllegalUsage);
+}
+
+
+void
+CSccsApplication::outputUsage ()
+{
+	std::cout << "Usage 1:" << std::endl <<
+		mArgv[0] << " input_file_1 input_file_2 changeset_file" << std::endl << std::endl <<
+		"Usage 2:" << std::endl <<
+		mArgv[0] << " input_file output_file [input_file output_file ...] changeset_file /apply" << std::endl << std::endl <<
+		"Usage 3:" << std::endl <<
+		mArgv[0] << " /server:socket_path" << std::endl << std::endl <<
+		"Usage 4:" << std::endl <<
+		mArgv[0] << " target_file [target_file ...] changeset_file /check" << std::endl << std::endl <<
+		"Options:" << std::endl <<
+		"  /maxmem:SIZE    working memory budget of the comparison, K/M/G suffixes" << std::endl <<
+		"  /maxcost:N      give up the minimal diff past N edits, align greedily" << std::endl <<
+		"  /timeout:MS     give up the minimal diff after MS milliseconds, align greedily" << std::endl <<
+		"  /threads:N      threads diffing regions between anchors, all cores by default;" << std::endl <<
+		"                  requests served at once in server mode, files by /check and /apply" << std::endl <<
+		"  /whitespace:trailing|change" << std::endl <<
+		"                  ignore trailing whitespace or any change of its amount" << std::endl <<
+		"  /intraline[:word|char]" << std::endl <<
+		"                  write replacing lines as word or char edits of the replaced ones" << std::endl <<
+		"  /compress       write the changeset compressed, /apply detects it by itself" << std::endl <<
+		"  /fingerprint    record both files and hunk lines, /apply to the very first file" << std::endl <<
+		"                  then splices at those lines and checks the result" << std::endl <<
+		"  /fuzz:N         with /apply or /check, tolerate N mismatching context lines per hunk" << std::endl <<
+		"  /hashstats      report line hash collisions observed while comparing" << std::endl <<
+		"  /stats[:json]   report per-phase timings and counters to stderr" << std::endl << std::endl;
+}
+
+
+void
+CSccsApplication::initialize ()
+{
+	// Here we have setted working mode, just check for proper arguments number/positions
+	
+	int n_files = ((mFirstKey != 0) ? mFirstKey : mArgc) - 1;
+
+	if (! mServerPath.empty ())
+	{
+		THROW_IF (n_files != 0  ||  mApply  ||  mCheck  ||  mFuzz != 0, XIllegalUsage);
+		return;
+	}
+
+	THROW_IF (mFuzz != 0  &&  ! mApply  &&  ! mCheck, XIllegalUsage);
+	THROW_IF ((mNormalization != CHashedString::kNormalizeNone  ||  mIntraline != CIntraline::kModeNone  ||
+		mCompress  ||  mFingerprint)  &&  (mApply  ||  mCheck), XIllegalUsage);
+
+	if (mCheck)
+	{
+		// Targets are opened one by one while checking
+
+		THROW_IF (n_files < 2  ||  mApply, XIllegalUsage);
+
+		mTargetNames.assign (mArgv + 1, mArgv + n_files);
+		mFileDiffName = mArgv [n_files];
+
+		mFileDiff = fopen (mFileDiffName.c_str (), "r");
+		THROW_IF_NOT_WINFO (mFileDiff, XCantOpen, mFileDiffName.c_str ());
+
+		return;
+	}
+
+	if (mApply  &&  n_files > 3)
+	{
+		// Input and output pairs, then the change set
+
+		THROW_IF (n_files % 2 == 0, XIllegalUsage);
+
+		for (int i = 1; i < n_files; i += 2)
+		{
+			mTargetNames.push_back (mArgv [i]);
+			mOutputNames.push_back (mArgv [i + 1]);
+		}
+
+		mFileDiffName = mArgv [n_files];
+
+		mFileDiff = fopen (mFileDiffName.c_str (), "r");
+		THROW_IF_NOT_WINFO (mFileDiff, XCantOpen, mFileDiffName.c_str ());
+
+		return;
+	}
+
+	THROW_IF (n_files != 3, XIllegalUsage);
+	
+	mFile1Name = mArgv [1];
+	mFile2Name = mArgv [2];
+	mFileDiffName = mArgv [3];
+
+    mFile1 = fopen (mFile1Name.c_str (), "r");
+	THROW_IF_NOT_WINFO (mFile1, XCantOpen, mFile1Name.c_str());
+	
+	mFile2 = fopen (mFile2Name.c_str (), (mApply) ? "w" : "r");
+	THROW_IF_NOT_WINFO (mFile2, XCantOpen, mFile2Name.c_str());
+	
+	mFileDiff = fopen (mFileDiffName.c_str (), (mApply) ? "r" : "w");
+	THROW_IF_NOT_WINFO (mFileDiff, XCantOpen, mFileDiffName.c_str ());
+}
+
+
+void
+CSccsApplication::destroy ()
+{
+	// Clean up properly, close opened files & whatever
+	
+	if (mFile1 != NULL)
+	{
+		fclose (mFile1);
+		mFile1 = NULL;
+	}
+	
+	if (mFile2 != NULL)
+	{
+		fclose (mFile2);
+		mFile2 = NULL;
+
+		if (mReturnCode != RC_OK  &&  mApply)
+		{
+			// Output file generation failed, delete it
+			
+			unlink (mFile2Name.c_str ());
+		}
+	}
+	
+	if (mFileDiff != NULL)
+	{
+		fclose (mFileDiff);
+		mFileDiff = NULL;
+		
+		if (mReturnCode != RC_OK  &&  ! mApply  &&  ! mCheck)
+		{
+			// Changeset file generation failed, delete it
+			
+			unlink (mFileDiffName.c_str ());
+		}
+	}
+
+	if (mStats)
+	{
+		// Files are closed, output is fully accounted
+
+		mStats->set (CStats::kHashMatches, CHashedString::getHashMatches ());
+		mStats->set (CStats::kHashCollisions, CHashedString::getHashCollisions ());
+
+		mStats->output (std::cerr, mStatsJson);
+
+		CStats::install (NULL);
+		mStats.reset ();
+	}
+}
+
+
+void
+CSccsApplication::execute ()
+{
+//	cmp::testCharacterDiff ("abceghj", "abdbfehj");	// quick algo test
+
+	if (! mServerPath.empty ())
+	{
+		// Serve requests until stopped, the pool takes one connection per thread
+
+		CSccsOptions options;
+
+		options.mMaxMemory = mMaxMemory;
+		options.mMaxCost = mMaxCost;
+		options.mTimeout = mTimeout;
+		options.mNormalization = mNormalization;
+		options.mIntraline = mIntraline;
+		options.mCompress = mCompress;
+		options.mFingerprint = mFingerprint;
+
+		CSccsServer server (mServerPath, options, mThreads);
+
+		std::cerr << "Serving on " << mServerPath << std::endl;
+
+		server.run ();
+	}
+	else if (mCheck)
+	{
+		checkTargets ();
+	}
+	else if (! mOutputNames.empty ())
+	{
+		applyTargets ();
+	}
+	else if (mApply)
+	{
+		// Generate output file basing on changeset diff
+		
+		CChangeSetProcessor set_processor (mFile1, mFile2, mFileDiff);
+
+		set_processor.setFuzz (mFuzz);
+		set_processor.process ();
+
+		// Hunks whose context did not match exactly deserve a look
+
+		for (const CChangeSetProcessor::CFuzzReport &report : set_processor.getFuzzReport ())
+		{
+			std::cerr << "Hunk " << report.mHunk << " applied at line " << report.mLine <<
+				" with fuzz " << report.mFuzz << std::endl;
+		}
+	}
+	else
+	{
+		// Generate changeset diff file basing on two reference input files
+		
+        // instantiate two text file data sources;one for each file
+
+		CDataSourceTextFile compare_data1 (mFile1);
+        CDataSourceTextFile compare_data2 (mFile2);
+
+		CSccsOptions options;
+
+		options.mMaxMemory = mMaxMemory;
+		options.mMaxCost = mMaxCost;
+		options.mTimeout = mTimeout;
+		options.mNormalization = mNormalization;
+		options.mIntraline = mIntraline;
+		options.mCompress = mCompress;
+		options.mFingerprint = mFingerprint;
+
+		// Regions between anchors of big inputs are diffed in parallel,
+		// the calling thread takes its share
+
+		std::unique_ptr<CThreadPool> pool;
+
+		size_t threads = (mThreads != 0) ? mThreads : std::thread::hardware_concurrency ();
+
+		if (threads > 1)
+		{
+			pool.reset (new CThreadPool (threads - 1));
+			options.mPool = pool.get ();
+		}
+
+		CChangeSetBuilder set_builder (mFileDiff, compare_data1, compare_data2);
+		CSccsDiffInfo info;
+
+		CSccs::diff (compare_data1, compare_data2, set_builder, options, &info, mFile1Name.c_str ());
+
+		// Let know if the budget or latency knobs forced a leaner strategy
+
+		bool bounded = (mMaxCost != 0  ||  mTimeout != 0);
+
+		if (mMaxMemoryGiven  ||  bounded  ||  info.mStrategy != cmp::kStrategyFull)
+		{
+			std::cerr << "Diff strategy: " << cmp::getStrategyName (info.mStrategy);
+
+			if (info.mStrategy == cmp::kStrategyAnchored)
+			{
+				std::cerr << ", " << info.mAnchors << " anchors";
+			}
+
+			if (bounded)
+			{
+				std::cerr << ", " << info.mEdits << " edits, minimal is at least " << info.mMinEdits;
+			}
+
+			std::cerr << std::endl;
+		}
+	}
+
+	if (mHashStats)
+	{
+		std::cerr << "Hash-equal compares: " << CHashedString::getHashMatches () <<
+			", collisions: " << CHashedString::getHashCollisions () << std::endl;
+	}
+}
+
+
+// Exception as a report line tells it
+
+static std::string
+describe (const XException &inEx)
+{
+	std::string text = std::string (inEx.who ()) + " (" + inEx.what ();
+
+	if (*inEx.info () != '\0')
+	{
+		text.append (": ").append (inEx.info ());
+	}
+
+	return text + ")";
+}
+
+
+void
+CSccsApplication::readChangeSet (CChangeSet &outSet)
+{
+	CLineReader reader (mFileDiff);
+
+	reader.acceptCompressed ();
+	outSet.read (reader);
+}
+
+
+void
+CSccsApplication::forEachTarget (const std::function<void (size_t)> &inBody)
+{
+	size_t count = mTargetNames.size ();
+	size_t threads = std::min (count, (mThreads != 0) ? mThreads : (size_t) std::thread::hardware_concurrency ());
+
+	if (threads > 1)
+	{
+		CThreadPool pool (threads - 1);
+		pool.parallelFor (count, inBody);
+	}
+	else
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			inBody (i);
+		}
+	}
+}
+
+
+// Reports are written in the order of the targets once all of them are done
+
+void
+CSccsApplication::checkTargets ()
+{
+	CChangeSet changeset;
+
+	readChangeSet (changeset);
+
+	size_t count = mTargetNames.size ();
+
+	std::vector<std::string> reports (count);
+	std::vector<char> applies (count, false);
+
+	std::function<void (size_t)> check = [&] (size_t inIndex)
+	{
+		const std::string &name = mTargetNames [inIndex];
+		std::ostringstream report;
+
+		try
+		{
+			FILE *file = fopen (name.c_str (), "r");
+			THROW_IF_NOT_WINFO (file, XCantOpen, name.c_str ());
+
+			std::unique_ptr<FILE, int (*) (FILE *)> closer (file, fclose);
+
+			CChangeSetProcessor set_processor (file, NULL, changeset);
+
+			set_processor.setFuzz (mFuzz);
+			set_processor.setCheckOnly (true);
+			set_processor.process ();
+
+			for (const CChangeSetProcessor::CHunkStatus &status : set_processor.getHunkStatus ())
+			{
+				report << name << ": hunk " << status.mHunk;
+
+				switch (status.mStatus)
+				{
+				case CChangeSetProcessor::kHunkApplies:
+
+					report << " applies at line " << status.mLine;
+
+					if (status.mFuzz != 0)
+					{
+						report << " with fuzz " << status.mFuzz;
+					}
+
+					break;
+
+				case CChangeSetProcessor::kHunkNotFound:
+
+					report << ": context not found: " << status.mContext;
+					break;
+
+				case CChangeSetProcessor::kHunkAmbiguous:
+
+					report << ": context not unique: " << status.mContext;
+					break;
+				}
+
+				report << std::endl;
+			}
+
+			applies [inIndex] = set_processor.isApplicable ();
+		}
+		catch (const XException &ex)
+		{
+			report << name << ": " << describe (ex) << std::endl;
+		}
+		catch (const std::exception &ex)
+		{
+			report << name << ": " << ex.what () << std::endl;
+		}
+
+		report << name << ((applies [inIndex]) ? ": applies" : ": does not apply") << std::endl;
+
+		reports [inIndex] = report.str ();
+	};
+
+	forEachTarget (check);
+
+	size_t failed = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		std::cout << reports [i];
+		failed += (applies [i]) ? 0 : 1;
+	}
+
+	if (failed != 0)
+	{
+		std::string info = std::to_string (failed) + " of " + std::to_string (count) + " files";
+		THROW_WINFO (XNotApplicable, info.c_str ());
+	}
+}
+
+
+// An output is written only if the change set applies to its input, it is
+// deleted otherwise. Results are written in the order of the targets
+
+void
+CSccsApplication::applyTargets ()
+{
+	CChangeSet changeset;
+
+	readChangeSet (changeset);
+
+	size_t count = mTargetNames.size ();
+
+	std::vector<std::string> reports (count);
+	std::vector<char> applied (count, false);
+
+	std::function<void (size_t)> apply = [&] (size_t inIndex)
+	{
+		const std::string &name = mTargetNames [inIndex];
+		const std::string &output = mOutputNames [inIndex];
+		std::ostringstream report;
+
+		FILE *file2 = NULL;
+
+		try
+		{
+			FILE *file1 = fopen (name.c_str (), "r");
+			THROW_IF_NOT_WINFO (file1, XCantOpen, name.c_str ());
+
+			std::unique_ptr<FILE, int (*) (FILE *)> closer (file1, fclose);
+
+			file2 = fopen (output.c_str (), "w");
+			THROW_IF_NOT_WINFO (file2, XCantOpen, output.c_str ());
+
+			CChangeSetProcessor set_processor (file1, file2, changeset);
+
+			set_processor.setFuzz (mFuzz);
+			set_processor.process ();
+
+			for (const CChangeSetProcessor::CFuzzReport &fuzz : set_processor.getFuzzReport ())
+			{
+				report << name << ": hunk " << fuzz.mHunk << " applied at line " << fuzz.mLine <<
+					" with fuzz " << fuzz.mFuzz << std::endl;
+			}
+
+			applied [inIndex] = true;
+		}
+		catch (const XException &ex)
+		{
+			report << name << ": " << describe (ex) << std::endl;
+		}
+		catch (const std::exception &ex)
+		{
+			// Out of memory or a system error fails this target only
+
+			report << name << ": " << ex.what () << std::endl;
+		}
+
+		if (file2 != NULL)
+		{
+			fclose (file2);
+
+			if (! applied [inIndex])
+			{
+				unlink (output.c_str ());
+			}
+		}
+
+		report << name << ((applied [inIndex]) ? ": applied to " + output : std::string (": not applied")) << std::endl;
+
+		reports [inIndex] = report.str ();
+	};
+
+	forEachTarget (apply);
+
+	size_t failed = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		std::cout << reports [i];
+		failed += (applied [i]) ? 0 : 1;
+	}
+
+	if (failed != 0)
+	{
+		std::string info = std::to_string (failed) + " of " + std::to_string (count) + " files";
+		THROW_WINFO (XNotApplicable, info.c_str ());
+	}
+}
+
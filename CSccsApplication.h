@@ -1,59 +1,99 @@
-#ifndef __CSccsApplication_h
-#define __CSccsApplication_h
-
-#include "CApplication.h"
-
-#include "stdio.h"
-
-#include "XExceptions.h"
-
-//
-// User exceptions declaration part
-//
-
-DECLARE_EXCEPTION(XComparisonFail, XRuntime, "Comparison failed");
-
-DECLARE_EXCEPTION(XEmptySource, XRuntime, "Empty source file");
-DECLARE_EXCEPTION(XFilesIdentical, XRuntime, "Files are identical");
-
-
-//
-//	class CSccsApplication
-//
-
-class CSccsApplication : public CApplication
-{
-public:
-
-    CSccsApplication (int argc, char *argv []);
-
-    virtual ~CSccsApplication ();
-
-    // Initialize/destroy affairs
-    virtual void initialize ();
-    virtual void destroy ();
-
-    // Configurate application via options
-    virtual void checkOption (const char *inOption);
-    
-    // Output usage line
-    virtual void outputUsage ();
-	
-    // Handles main affairs happened between initialize () & detroy ()
-    virtual void execute ();
-
-protected:
-
-	bool mApply;
-	
-	FILE *mFile1;
-	FILE *mFile2;
-	FILE *mFileDiff;
-
-	std::string mFile1Name;
-	std::string mFile2Name;
-	std::string mFileDiffName;
-};
-
-
-#endif	// __CSccsApplication_h
+#ifndef __CSccsApplication_h
+#define __CSccsApplication_h
+
+#include "CApplication.h"
+
+#include "stdio.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CStats.h"
+
+#include "CSccs.h"
+
+DECLARE_EXCEPTION(XNotApplicable, XRuntime, "Change set does not apply");
+
+
+//
+//	class CSccsApplication
+//
+
+class CSccsApplication : public CApplication
+{
+public:
+
+    CSccsApplication (int argc, char *argv []);
+
+    virtual ~CSccsApplication ();
+
+    // Initialize/destroy affairs
+    virtual void initialize ();
+    virtual void destroy ();
+
+    // Configurate application via options
+    virtual void checkOption (const char *inOption);
+    
+    // Output usage line
+    virtual void outputUsage ();
+	
+    // Handles main affairs happened between initialize () & detroy ()
+    virtual void execute ();
+
+protected:
+
+	// The change set is read once for all the targets, they are processed in
+	// parallel by inBody taking the index of the target
+
+	void readChangeSet (CChangeSet &outSet);
+	void forEachTarget (const std::function<void (size_t)> &inBody);
+
+	// Check the change set against every target, report how its hunks go
+
+	void checkTargets ();
+
+	// Apply the change set to every input, writing the output of the same index
+
+	void applyTargets ();
+
+	bool mApply;
+	bool mCheck;
+	bool mHashStats;
+
+	size_t mMaxMemory;		// working memory budget of the comparison
+	bool mMaxMemoryGiven;
+
+	size_t mMaxCost;		// latency knobs, 0 if unlimited
+	unsigned mTimeout;
+
+	size_t mThreads;		// 0 means one per hardware thread
+
+	CHashedString::ENormalization mNormalization;	// whitespace differences to ignore
+	CIntraline::EMode mIntraline;
+
+	bool mCompress;			// write compressed changesets
+	bool mFingerprint;		// record fingerprints and hunk lines
+
+	size_t mFuzz;			// mismatching context lines tolerated by /apply
+
+	std::string mServerPath;	// serve requests on this socket if given
+
+	std::unique_ptr<CStats> mStats;	// collected when /stats given
+	bool mStatsJson;
+	
+	FILE *mFile1;
+	FILE *mFile2;
+	FILE *mFileDiff;
+
+	std::string mFile1Name;
+	std::string mFile2Name;
+	std::string mFileDiffName;
+
+	std::vector<std::string> mTargetNames;	// files /check takes, or inputs of /apply
+	std::vector<std::string> mOutputNames;	// outputs of /apply to many files
+};
+
+
+#endif	// __CSccsApplication_h
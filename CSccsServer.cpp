@@ -0,0 +1,670 @@
+#include "stdafx.h"
+
+#include "CSccsServer.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+#ifndef _WIN32
+
+static volatile sig_atomic_t sStop = 0;
+
+
+static void
+onStopSignal (int)
+{
+	sStop = 1;
+}
+
+
+//
+//	class CSocketStream
+//
+//	Buffered reading and plain writing of a connected socket
+//
+
+class CSocketStream
+{
+public:
+
+	explicit CSocketStream (int inSocket) :
+		mSocket (inSocket), mBegin (0), mEnd (0)
+	{
+	}
+
+	// Line without its '\n', false if the peer closed the connection in between requests
+
+	bool readLine (std::string &outLine)
+	{
+		outLine.clear ();
+
+		for (;;)
+		{
+			const char *begin = mBuffer + mBegin;
+			const char *eol = (const char *) memchr (begin, '\n', mEnd - mBegin);
+
+			if (eol != NULL)
+			{
+				outLine.append (begin, eol - begin);
+				mBegin += eol - begin + 1;
+
+				return true;
+			}
+
+			outLine.append (begin, mEnd - mBegin);
+			mBegin = mEnd;
+
+			THROW_IF (outLine.size () > kMaxLine, XBadContent);
+
+			if (! fill ())
+			{
+				THROW_IF (! outLine.empty (), XCantRead);
+				return false;
+			}
+		}
+	}
+
+	void readBytes (size_t inLength, std::string &outData)
+	{
+		outData.clear ();
+		outData.reserve (inLength);
+
+		while (outData.size () < inLength)
+		{
+			if (mBegin == mEnd)
+			{
+				THROW_IF (! fill (), XCantRead);
+			}
+
+			size_t chunk = std::min (inLength - outData.size (), mEnd - mBegin);
+
+			outData.append (mBuffer + mBegin, chunk);
+			mBegin += chunk;
+		}
+	}
+
+	void write (const char *inData, size_t inLength)
+	{
+		while (inLength != 0)
+		{
+			ssize_t written = ::write (mSocket, inData, inLength);
+
+			if (written < 0  &&  errno == EINTR)
+			{
+				continue;
+			}
+
+			THROW_IF (written <= 0, XCantWrite);
+
+			inData += written;
+			inLength -= written;
+		}
+	}
+
+	void write (const std::string &inData)
+	{
+		write (inData.data (), inData.size ());
+	}
+
+	// Bytes of a following request are read already
+
+	bool hasBuffered () const { return mBegin != mEnd; }
+
+protected:
+
+	// prevent compiler autogeneration
+	CSocketStream ();
+	CSocketStream (const CSocketStream &);
+	CSocketStream &operator= (const CSocketStream &);
+
+	bool fill ()
+	{
+		for (;;)
+		{
+			ssize_t got = ::read (mSocket, mBuffer, sizeof (mBuffer));
+
+			if (got < 0  &&  errno == EINTR)
+			{
+				continue;
+			}
+
+			THROW_IF (got < 0, XCantRead);
+
+			mBegin = 0;
+			mEnd = got;
+
+			return got != 0;
+		}
+	}
+
+	static const size_t kMaxLine = 64 * 1024;
+
+	int mSocket;
+
+	char mBuffer [64 * 1024];
+	size_t mBegin;
+	size_t mEnd;
+};
+
+
+// Operand is inline data or a path, files are loaded once the request is complete
+
+static void
+readOperand (CSocketStream &inStream, std::string &outData, bool &outIsPath)
+{
+	std::string line;
+
+	THROW_IF (! inStream.readLine (line), XCantRead);
+
+	if (line.compare (0, 5, "FILE ") == 0)
+	{
+		outData.assign (line, 5, std::string::npos);
+		outIsPath = true;
+	}
+	else if (line.compare (0, 5, "DATA ") == 0)
+	{
+		char *end;
+		unsigned long long length = strtoull (line.c_str () + 5, &end, 10);
+
+		THROW_IF (end == line.c_str () + 5  ||  *end != '\0', XBadContent);
+		THROW_IF (length > CSccsServer::kMaxPayload, XOutOfRangeValue);
+
+		inStream.readBytes ((size_t) length, outData);
+		outIsPath = false;
+	}
+	else THROW (XBadContent);
+}
+
+
+static void
+loadFile (std::string &ioData)
+{
+	std::string path;
+	path.swap (ioData);
+
+	FILE *file = fopen (path.c_str (), "rb");
+	THROW_IF_NOT_WINFO (file, XCantOpen, path.c_str ());
+
+	char buffer [64 * 1024];
+	size_t got;
+
+	while ((got = fread (buffer, 1, sizeof (buffer), file)) != 0)
+	{
+		ioData.append (buffer, got);
+	}
+
+	bool failed = (ferror (file) != 0);
+	fclose (file);
+
+	THROW_IF_WINFO (failed, XCantRead, path.c_str ());
+}
+
+
+static std::string
+describe (const XException &inEx)
+{
+	std::string text = std::string (inEx.who ()) + " " + inEx.what ();
+
+	if (*inEx.info () != '\0')
+	{
+		text.append (": ").append (inEx.info ());
+	}
+
+	return text;
+}
+
+#endif	// _WIN32
+
+
+//
+//	class CSccsServer
+//
+
+#ifdef _WIN32
+
+CSccsServer::CSccsServer (const std::string &inPath, const CSccsOptions &inOptions, size_t) :
+	mPath (inPath), mOptions (inOptions), mListener (-1), mAcceptError (0)
+{
+	mWakeUp [0] = mWakeUp [1] = -1;
+
+	THROW (XUnimplementedCode);
+}
+
+
+CSccsServer::~CSccsServer ()
+{
+}
+
+
+void
+CSccsServer::run ()
+{
+}
+
+
+void
+CSccsServer::listen ()
+{
+}
+
+
+void
+CSccsServer::acceptConnection ()
+{
+}
+
+
+void
+CSccsServer::serveRequests (int)
+{
+}
+
+
+bool
+CSccsServer::serveRequest (CSocketStream &)
+{
+	return false;
+}
+
+
+void
+CSccsServer::closeConnection (int)
+{
+}
+
+#else
+
+CSccsServer::CSccsServer (const std::string &inPath, const CSccsOptions &inOptions, size_t inThreads) :
+	mPath (inPath),
+	mOptions (inOptions),
+	mListener (-1),
+	mAcceptError (0),
+	mPool (new CThreadPool (inThreads))
+{
+	// Connection workers lend themselves to the gaps of big diffs when idle
+
+	mOptions.mPool = mPool.get ();
+
+	THROW_IF (pipe (mWakeUp) != 0, XCantInit);
+
+	for (int end : mWakeUp)
+	{
+		fcntl (end, F_SETFD, FD_CLOEXEC);
+		fcntl (end, F_SETFL, O_NONBLOCK);
+	}
+
+	listen ();
+}
+
+
+CSccsServer::~CSccsServer ()
+{
+	if (mListener != -1)
+	{
+		close (mListener);
+		unlink (mPath.c_str ());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+
+		for (const auto &connection : mConnections)
+		{
+			shutdown (connection.first, SHUT_RDWR);
+		}
+	}
+
+	mPool.reset ();
+
+	// Idle connections are left, no worker closes them
+
+	for (const auto &connection : mConnections)
+	{
+		close (connection.first);
+	}
+
+	close (mWakeUp [0]);
+	close (mWakeUp [1]);
+}
+
+
+void
+CSccsServer::listen ()
+{
+	sockaddr_un address;
+
+	memset (&address, 0, sizeof (address));
+	address.sun_family = AF_UNIX;
+
+	THROW_IF_WINFO (mPath.empty ()  ||  mPath.size () >= sizeof (address.sun_path), XBadParameter, mPath.c_str ());
+	memcpy (address.sun_path, mPath.c_str (), mPath.size ());
+
+	int listener = socket (AF_UNIX, SOCK_STREAM, 0);
+	THROW_IF_WINFO (listener == -1, XCantInit, mPath.c_str ());
+
+	fcntl (listener, F_SETFD, FD_CLOEXEC);
+
+	// A socket left by a dead server is replaced, a live one is not
+
+	if (connect (listener, (sockaddr *) &address, sizeof (address)) == 0)
+	{
+		close (listener);
+		THROW_WINFO (XAlreadyInited, mPath.c_str ());
+	}
+
+	close (listener);
+	unlink (mPath.c_str ());
+
+	listener = socket (AF_UNIX, SOCK_STREAM, 0);
+	THROW_IF_WINFO (listener == -1, XCantInit, mPath.c_str ());
+
+	fcntl (listener, F_SETFD, FD_CLOEXEC);
+
+	// FILE operands are read with the rights of the server, so only its own
+	// user may connect. Nothing is accepted before listen (), the socket is
+	// never open to others in between
+
+	if (bind (listener, (sockaddr *) &address, sizeof (address)) != 0  ||
+		chmod (mPath.c_str (), S_IRUSR | S_IWUSR) != 0  ||  ::listen (listener, SOMAXCONN) != 0)
+	{
+		close (listener);
+		THROW_WINFO (XCantInit, mPath.c_str ());
+	}
+
+	mListener = listener;
+}
+
+
+void
+CSccsServer::run ()
+{
+	struct sigaction action;
+
+	memset (&action, 0, sizeof (action));
+	action.sa_handler = onStopSignal;
+
+	sigaction (SIGINT, &action, NULL);
+	sigaction (SIGTERM, &action, NULL);
+
+	// Clients going away mid-answer are reported by write ()
+
+	signal (SIGPIPE, SIG_IGN);
+
+	sStop = 0;
+
+	std::vector<pollfd> ready;
+
+	while (! sStop)
+	{
+		ready.clear ();
+		ready.push_back ({ mListener, POLLIN, 0 });
+		ready.push_back ({ mWakeUp [0], POLLIN, 0 });
+
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+
+			for (int connection : mIdle)
+			{
+				ready.push_back ({ connection, POLLIN, 0 });
+			}
+		}
+
+		// The signal may hit a worker, so poll with a timeout rather than block
+
+		if (poll (ready.data (), ready.size (), 200) <= 0)
+		{
+			continue;
+		}
+
+		if (ready [1].revents != 0)
+		{
+			char drain [256];
+
+			while (read (mWakeUp [0], drain, sizeof (drain)) > 0)
+			{
+			}
+		}
+
+		// A request coming, or the client hanging up, is up to a worker
+
+		for (size_t i = 2; i < ready.size (); i++)
+		{
+			if (ready [i].revents != 0)
+			{
+				int connection = ready [i].fd;
+
+				{
+					std::lock_guard<std::mutex> lock (mMutex);
+					mIdle.erase (connection);
+				}
+
+				mPool->post ([this, connection] ()
+				{
+					serveRequests (connection);
+				});
+			}
+		}
+
+		if (ready [0].revents != 0)
+		{
+			acceptConnection ();
+		}
+	}
+}
+
+
+// Running out of descriptors or memory is not fatal, the server goes on
+// with the clients it has and retries after a pause
+
+void
+CSccsServer::acceptConnection ()
+{
+	int connection = accept (mListener, NULL, NULL);
+
+	if (connection == -1)
+	{
+		if (errno == EINTR  ||  errno == ECONNABORTED  ||  errno == EAGAIN)
+		{
+			return;
+		}
+
+		// Reported once per streak, the listener stays readable meanwhile
+
+		if (errno != mAcceptError)
+		{
+			mAcceptError = errno;
+			std::cerr << "Can't accept a connection: " << strerror (errno) << std::endl;
+		}
+
+		std::this_thread::sleep_for (std::chrono::milliseconds (kAcceptBackoff));
+		return;
+	}
+
+	mAcceptError = 0;
+
+	fcntl (connection, F_SETFD, FD_CLOEXEC);
+
+	// A client stalling mid-request or not taking its answer holds a worker,
+	// but for a while only
+
+	timeval timeout = { kIoTimeout, 0 };
+
+	setsockopt (connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+	setsockopt (connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof (timeout));
+
+	std::lock_guard<std::mutex> lock (mMutex);
+
+	mConnections [connection] = std::make_shared<CSocketStream> (connection);
+	mIdle.insert (connection);
+}
+
+
+// Requests the client has sent already are served in a row, then the
+// connection goes back to run () to wait for the next one
+
+void
+CSccsServer::serveRequests (int inSocket)
+{
+	std::shared_ptr<CSocketStream> stream;
+
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		stream = mConnections [inSocket];
+	}
+
+	bool keep = false;
+
+	try
+	{
+		do
+		{
+			keep = serveRequest (*stream);
+		}
+		while (keep  &&  stream->hasBuffered ());
+	}
+	catch (const XException &ex)
+	{
+		// Broken request, the stream is out of sync, so tell and hang up
+
+		std::string answer = "ERROR " + describe (ex) + "\n";
+
+		try
+		{
+			stream->write (answer);
+		}
+		catch (...)
+		{
+		}
+
+		keep = false;
+	}
+	catch (...)
+	{
+		keep = false;
+	}
+
+	if (! keep)
+	{
+		closeConnection (inSocket);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock (mMutex);
+
+	mIdle.insert (inSocket);
+
+	// run () polls without it till woken, a full pipe wakes it anyway
+
+	ssize_t written = ::write (mWakeUp [1], "", 1);
+	(void) written;
+}
+
+
+bool
+CSccsServer::serveRequest (CSocketStream &inStream)
+{
+	// Buffers stay with the worker, so their memory is reused by the following requests
+
+	static thread_local std::string sFirst, sSecond, sResult;
+
+	std::string command;
+
+	if (! inStream.readLine (command))
+	{
+		return false;
+	}
+
+	if (command == "PING")
+	{
+		inStream.write ("OK 0\n", 5);
+		return true;
+	}
+
+	bool diff = (command == "DIFF");
+
+	THROW_IF (! diff  &&  command != "APPLY", XBadContent);
+
+	bool firstIsPath, secondIsPath;
+
+	readOperand (inStream, sFirst, firstIsPath);
+	readOperand (inStream, sSecond, secondIsPath);
+
+	sResult.clear ();
+
+	std::string answer;
+
+	try
+	{
+		if (firstIsPath)
+		{
+			loadFile (sFirst);
+		}
+
+		if (secondIsPath)
+		{
+			loadFile (sSecond);
+		}
+
+		if (diff)
+		{
+			CSccs::diff (sFirst.data (), sFirst.size (), sSecond.data (), sSecond.size (), &sResult, mOptions);
+		}
+		else
+		{
+			CSccs::apply (sFirst.data (), sFirst.size (), sSecond.data (), sSecond.size (), &sResult);
+		}
+
+		answer = "OK " + std::to_string (sResult.size ()) + "\n";
+	}
+	catch (const XException &ex)
+	{
+		sResult.clear ();
+		answer = "ERROR " + describe (ex) + "\n";
+	}
+	catch (const std::exception &ex)
+	{
+		sResult.clear ();
+		answer = std::string ("ERROR ") + ex.what () + "\n";
+	}
+
+	inStream.write (answer);
+	inStream.write (sResult);
+
+	// ...unless a huge request would pin its memory for good
+
+	if (sFirst.capacity () + sSecond.capacity () + sResult.capacity () > kKeepCapacity)
+	{
+		std::string ().swap (sFirst);
+		std::string ().swap (sSecond);
+		std::string ().swap (sResult);
+	}
+
+	return true;
+}
+
+
+void
+CSccsServer::closeConnection (int inSocket)
+{
+	std::lock_guard<std::mutex> lock (mMutex);
+
+	mConnections.erase (inSocket);
+	close (inSocket);
+}
+
+#endif	// _WIN32
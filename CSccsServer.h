@@ -0,0 +1,96 @@
+#ifndef __CSccsServer_h
+#define __CSccsServer_h
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "CSccs.h"
+#include "CThreadPool.h"
+
+class CSocketStream;
+
+
+//
+//	class CSccsServer
+//
+//	Serves diff and apply requests over a local Unix domain socket, so that
+//	many small jobs don't pay the process startup each. A connection may carry
+//	any number of requests, each one served by a pool worker. Connections
+//	waiting for their next request are polled by run () and hold no worker:
+//
+//		DIFF | APPLY | PING
+//		FILE <path>  or  DATA <length> followed by the bytes	(two operands)
+//
+//	Operands are the source and the target (DIFF) or the changeset (APPLY).
+//	The answer is "OK <length>" followed by the bytes, or "ERROR <exception>
+//	<message>". Not available on Windows
+//
+//	FILE operands are opened with the rights of the server, so the socket is
+//	accessible to the user running it only (mode 0600). Whoever can connect
+//	may read any file the server can
+//
+
+class CSccsServer
+{
+public:
+
+	CSccsServer (const std::string &inPath, const CSccsOptions &inOptions, size_t inThreads);
+
+	// Drops the open connections and removes the socket
+	virtual ~CSccsServer ();
+
+	// Accepts connections and waits for their requests until SIGINT or SIGTERM
+	void run ();
+
+	// Biggest inline operand accepted
+	static const size_t kMaxPayload = (size_t) 1 << 30;
+
+	// Longest wait for the rest of a request or for the client to take the
+	// answer, in seconds. The connection is dropped past it
+	static const int kIoTimeout = 30;
+
+protected:
+
+	// prevent compiler autogeneration
+	CSccsServer ();
+	CSccsServer (const CSccsServer &);
+	CSccsServer &operator= (const CSccsServer &);
+
+	// Per worker buffer memory kept in between requests
+	static const size_t kKeepCapacity = (size_t) 64 << 20;
+
+	// Pause after accept () failed for lack of descriptors or memory, ms
+	static const int kAcceptBackoff = 100;
+
+	void listen ();
+
+	void acceptConnection ();
+
+	// Requests the connection has sent, then it is polled again or closed
+
+	void serveRequests (int inSocket);
+
+	// False if the client closed the connection in between requests
+	bool serveRequest (CSocketStream &inStream);
+
+	void closeConnection (int inSocket);
+
+	std::string mPath;
+	CSccsOptions mOptions;
+
+	int mListener;
+	int mAcceptError;		// errno of the last failed accept (), 0 once one succeeds
+
+	std::mutex mMutex;
+	std::map<int, std::shared_ptr<CSocketStream> > mConnections;	// shut down on exit to wake their workers
+	std::set<int> mIdle;			// waiting for their next request
+	int mWakeUp [2];				// pipe run () polls, written when a connection gets idle
+
+	std::unique_ptr<CThreadPool> mPool;
+};
+
+
+#endif	// __CSccsServer_h
@@ -0,0 +1,162 @@
+#include "stdafx.h"
+
+#include "CStats.h"
+
+#include <chrono>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+CStats *CStats::sInstance = NULL;
+
+
+static const char *const sPhaseNames [CStats::kPhaseCount] =
+{
+	"read", "lcs", "script", "context", "parse", "search", "edit", "write"
+};
+
+static const char *const sCounterNames [CStats::kCounterCount] =
+{
+	"lines_read", "lcs_cells", "unique_checks", "pattern_checks",
+	"hash_matches", "hash_collisions", "bytes_written"
+};
+
+
+//
+//	class CStats
+//
+
+CStats::CStats ()
+{
+	for (CPhase &phase : mPhases)
+	{
+		phase.mWallNs = 0;
+		phase.mCpuNs = 0;
+		phase.mCalls = 0;
+	}
+
+	for (std::atomic<uint64_t> &counter : mCounters)
+	{
+		counter = 0;
+	}
+
+	mStartNs = wallClock ();
+}
+
+
+CStats::~CStats ()
+{
+	if (sInstance == this)
+	{
+		sInstance = NULL;
+	}
+}
+
+
+uint64_t
+CStats::wallClock ()
+{
+	return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+
+uint64_t
+CStats::cpuClock ()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+
+	if (! GetThreadTimes (GetCurrentThread (), &creation, &exit, &kernel, &user))
+	{
+		return 0;
+	}
+
+	// FILETIME counts 100 ns intervals
+
+	return ((((uint64_t) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+		(((uint64_t) user.dwHighDateTime << 32) | user.dwLowDateTime)) * 100;
+#else
+	timespec ts;
+
+	if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+	{
+		return 0;
+	}
+
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+
+void
+CStats::addPhase (EPhase inPhase, uint64_t inWallNs, uint64_t inCpuNs)
+{
+	CPhase &phase = mPhases [inPhase];
+
+	phase.mWallNs.fetch_add (inWallNs, std::memory_order_relaxed);
+	phase.mCpuNs.fetch_add (inCpuNs, std::memory_order_relaxed);
+	phase.mCalls.fetch_add (1, std::memory_order_relaxed);
+}
+
+
+void
+CStats::output (std::ostream &outStream, bool inJson) const
+{
+	double totalMs = (wallClock () - mStartNs) / 1e6;
+
+	std::ios_base::fmtflags flags = outStream.flags ();
+	std::streamsize precision = outStream.precision ();
+
+	outStream << std::fixed << std::setprecision (3);
+
+	if (inJson)
+	{
+		outStream << "{ \"total_ms\": " << totalMs << ", \"phases\": {";
+
+		for (int i = 0; i < kPhaseCount; i++)
+		{
+			outStream << (i ? ", " : " ") << "\"" << sPhaseNames [i] << "\": { \"wall_ms\": " <<
+				mPhases [i].mWallNs / 1e6 << ", \"cpu_ms\": " << mPhases [i].mCpuNs / 1e6 <<
+				", \"calls\": " << mPhases [i].mCalls << " }";
+		}
+
+		outStream << " }, \"counters\": {";
+
+		for (int i = 0; i < kCounterCount; i++)
+		{
+			outStream << (i ? ", " : " ") << "\"" << sCounterNames [i] << "\": " << mCounters [i];
+		}
+
+		outStream << " } }" << std::endl;
+	}
+	else
+	{
+		outStream << std::left << std::setw (16) << "phase" << std::right <<
+			std::setw (12) << "wall ms" << std::setw (12) << "cpu ms" << std::setw (10) << "calls" << std::endl;
+
+		for (int i = 0; i < kPhaseCount; i++)
+		{
+			outStream << std::left << std::setw (16) << sPhaseNames [i] << std::right <<
+				std::setw (12) << mPhases [i].mWallNs / 1e6 << std::setw (12) << mPhases [i].mCpuNs / 1e6 <<
+				std::setw (10) << mPhases [i].mCalls << std::endl;
+		}
+
+		outStream << std::left << std::setw (16) << "total" << std::right <<
+			std::setw (12) << totalMs << std::endl << std::endl;
+
+		for (int i = 0; i < kCounterCount; i++)
+		{
+			outStream << std::left << std::setw (16) << sCounterNames [i] << std::right <<
+				std::setw (12) << mCounters [i] << std::endl;
+		}
+	}
+
+	outStream.flags (flags);
+	outStream.precision (precision);
+}
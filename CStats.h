@@ -0,0 +1,150 @@
+#ifndef __CStats_h
+#define __CStats_h
+
+#include <stdint.h>
+#include <atomic>
+#include <iostream>
+
+
+//
+//	class CStats
+//
+//	Per-phase wall/CPU timings and counters of a run. Nothing is collected unless
+//	a CStats object is installed, instrumented code then costs a null pointer check
+//
+
+class CStats
+{
+public:
+
+	enum EPhase
+	{
+		kPhaseRead = 0,		// reading, splitting and hashing lines
+		kPhaseLcs,			// LCS computation
+		kPhaseScript,		// edit script traceback
+		kPhaseContext,		// growing unique contexts of the changeset
+		kPhaseParse,		// changeset parsing
+		kPhaseSearch,		// context search while applying
+		kPhaseEdit,			// splicing lines while applying
+		kPhaseWrite,		// output system calls
+		kPhaseCount
+	};
+
+	enum ECounter
+	{
+		kLinesRead = 0,
+		kCellsEvaluated,	// LCS cells
+		kUniqueChecks,		// CChangeSetBuilder::isUnique calls
+		kPatternChecks,		// CChangeSetProcessor::checkPattern calls
+		kHashMatches,		// compares of lines with equal hashes
+		kHashCollisions,	// ...where the lines differ
+		kBytesWritten,
+		kCounterCount
+	};
+
+	CStats ();
+
+	virtual ~CStats ();
+
+	// Make the object collect statistics, NULL stops collection
+
+	static void install (CStats *inStats) { sInstance = inStats; }
+
+	static CStats *get () { return sInstance; }
+
+	void add (ECounter inCounter, uint64_t inValue)
+	{
+		mCounters [inCounter].fetch_add (inValue, std::memory_order_relaxed);
+	}
+
+	void set (ECounter inCounter, uint64_t inValue)
+	{
+		mCounters [inCounter].store (inValue, std::memory_order_relaxed);
+	}
+
+	void addPhase (EPhase inPhase, uint64_t inWallNs, uint64_t inCpuNs);
+
+	// Human-readable table or JSON object
+
+	void output (std::ostream &outStream, bool inJson) const;
+
+	// Clocks in nanoseconds, CPU time is the one of the calling thread
+
+	static uint64_t wallClock ();
+	static uint64_t cpuClock ();
+
+protected:
+
+	// prevent compiler autogeneration
+	CStats (const CStats &);
+	CStats &operator= (const CStats &);
+
+	struct CPhase
+	{
+		std::atomic<uint64_t> mWallNs;
+		std::atomic<uint64_t> mCpuNs;
+		std::atomic<uint64_t> mCalls;
+	};
+
+	CPhase mPhases [kPhaseCount];
+	std::atomic<uint64_t> mCounters [kCounterCount];
+
+	uint64_t mStartNs;
+
+	static CStats *sInstance;
+};
+
+
+//
+//	class CStatsPhase
+//
+//	Accounts time from construction to destruction to the phase
+//
+
+class CStatsPhase
+{
+public:
+
+	explicit CStatsPhase (CStats::EPhase inPhase) :
+		mStats (CStats::get ()),
+		mPhase (inPhase)
+	{
+		if (mStats != NULL)
+		{
+			mWallNs = CStats::wallClock ();
+			mCpuNs = CStats::cpuClock ();
+		}
+	}
+
+	~CStatsPhase ()
+	{
+		if (mStats != NULL)
+		{
+			mStats->addPhase (mPhase, CStats::wallClock () - mWallNs, CStats::cpuClock () - mCpuNs);
+		}
+	}
+
+protected:
+
+	// prevent compiler autogeneration
+	CStatsPhase ();
+	CStatsPhase (const CStatsPhase &);
+	CStatsPhase &operator= (const CStatsPhase &);
+
+	CStats *mStats;
+	CStats::EPhase mPhase;
+
+	uint64_t mWallNs;
+	uint64_t mCpuNs;
+};
+
+
+#define STATS_PHASE(phase) CStatsPhase statsPhase__ (CStats::phase)
+
+#define STATS_COUNT(counter, value) \
+{ \
+	if (CStats *stats__ = CStats::get ()) stats__->add (CStats::counter, (value)); \
+}
+
+
+#endif	// __CStats_h
@@ -0,0 +1,198 @@
+#include "stdafx.h"
+
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+
+//
+//	struct CLoopState
+//
+//	Shared by the caller of parallelFor () and its helper tasks, helpers
+//	started after the loop was closed leave without touching the body
+//
+
+struct CLoopState
+{
+	CLoopState (size_t inCount, const std::function<void (size_t)> &inBody) :
+		mNext (0), mCount (inCount), mBody (&inBody), mActive (0), mClosed (false)
+	{
+	}
+
+	void run ()
+	{
+		for (;;)
+		{
+			size_t index = mNext.fetch_add (1);
+
+			if (index >= mCount)
+			{
+				break;
+			}
+
+			try
+			{
+				(*mBody) (index);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock (mMutex);
+
+				if (! mError)
+				{
+					mError = std::current_exception ();
+				}
+
+				mNext = mCount;
+			}
+		}
+	}
+
+	std::atomic<size_t> mNext;
+	size_t mCount;
+	const std::function<void (size_t)> *mBody;
+
+	std::mutex mMutex;
+	std::condition_variable mIdle;
+
+	size_t mActive;			// helpers inside run ()
+	bool mClosed;			// caller is done, late helpers must leave
+
+	std::exception_ptr mError;
+};
+
+
+//
+//	class CThreadPool
+//
+
+CThreadPool::CThreadPool (size_t inThreads) :
+	mStop (false)
+{
+	if (inThreads == 0)
+	{
+		inThreads = std::max (1u, std::thread::hardware_concurrency ());
+	}
+
+	mWorkers.reserve (inThreads);
+
+	for (size_t i = 0; i < inThreads; i++)
+	{
+		mWorkers.push_back (std::thread (&CThreadPool::workerLoop, this));
+	}
+}
+
+
+CThreadPool::~CThreadPool ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		mStop = true;
+	}
+
+	mWake.notify_all ();
+
+	for (std::thread &worker : mWorkers)
+	{
+		worker.join ();
+	}
+}
+
+
+void
+CThreadPool::post (std::function<void ()> inTask)
+{
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		mTasks.push_back (std::move (inTask));
+	}
+
+	mWake.notify_one ();
+}
+
+
+void
+CThreadPool::workerLoop ()
+{
+	for (;;)
+	{
+		std::function<void ()> task;
+
+		{
+			std::unique_lock<std::mutex> lock (mMutex);
+
+			mWake.wait (lock, [this] { return mStop  ||  ! mTasks.empty (); });
+
+			if (mTasks.empty ())
+			{
+				return;		// stopped and drained
+			}
+
+			task = std::move (mTasks.front ());
+			mTasks.pop_front ();
+		}
+
+		try
+		{
+			task ();
+		}
+		catch (...)
+		{
+		}
+	}
+}
+
+
+void
+CThreadPool::parallelFor (size_t inCount, const std::function<void (size_t)> &inBody)
+{
+	if (inCount == 0)
+	{
+		return;
+	}
+
+	std::shared_ptr<CLoopState> state = std::make_shared<CLoopState> (inCount, inBody);
+
+	size_t helpers = std::min (mWorkers.size (), inCount - 1);
+
+	for (size_t i = 0; i < helpers; i++)
+	{
+		post ([state] ()
+		{
+			{
+				std::lock_guard<std::mutex> lock (state->mMutex);
+
+				if (state->mClosed)
+				{
+					return;
+				}
+
+				state->mActive ++;
+			}
+
+			state->run ();
+
+			{
+				std::lock_guard<std::mutex> lock (state->mMutex);
+				state->mActive --;
+			}
+
+			state->mIdle.notify_all ();
+		});
+	}
+
+	state->run ();
+
+	std::unique_lock<std::mutex> lock (state->mMutex);
+
+	state->mClosed = true;
+	state->mIdle.wait (lock, [&state] { return state->mActive == 0; });
+
+	if (state->mError)
+	{
+		std::rethrow_exception (state->mError);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef __CThreadPool_h
+#define __CThreadPool_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//
+//	class CThreadPool
+//
+//	Fixed set of worker threads fed from a single queue. The caller of
+//	parallelFor () works on the loop too, so a loop never waits for a busy
+//	pool and loops may be nested into pool tasks
+//
+
+class CThreadPool
+{
+public:
+
+	// 0 threads means one per hardware thread
+	explicit CThreadPool (size_t inThreads = 0);
+
+	// Runs the queued tasks and joins the workers
+	virtual ~CThreadPool ();
+
+	size_t getSize () const { return mWorkers.size (); }
+
+	// Queue a task, the task is responsible for its exceptions,
+	// anything escaping it is dropped
+
+	void post (std::function<void ()> inTask);
+
+	// Call inBody for every index of [0, inCount), returns when all calls
+	// are done. The first exception thrown by inBody is rethrown, indices
+	// not started yet are skipped then
+
+	void parallelFor (size_t inCount, const std::function<void (size_t)> &inBody);
+
+protected:
+
+	// prevent compiler autogeneration
+	CThreadPool (const CThreadPool &);
+	CThreadPool &operator= (const CThreadPool &);
+
+	void workerLoop ();
+
+	std::vector<std::thread> mWorkers;
+	std::deque<std::function<void ()> > mTasks;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+
+	bool mStop;
+};
+
+
+#endif	// __CThreadPool_h
@@ -0,0 +1,15 @@
+#include "stdafx.h"
+
+#include "CBenchApplication.h"
+
+//
+//	main
+//
+
+int main (int argc, char *argv [])
+{
+	CBenchApplication app (argc, argv);
+	app.run ();
+
+	return app.getReturnCode ();
+}
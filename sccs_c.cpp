@@ -0,0 +1,256 @@
+#include "stdafx.h"
+
+#include "sccs_c.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+#include "CSccs.h"
+#include "CChangeSetProcessor.h"
+#include "CThreadPool.h"
+
+
+static thread_local std::string sLastError;
+
+// sccs_options of API version 1, callers built against it pass this size
+
+static const size_t kOptionsSizeV1 = offsetof (sccs_options, threads) + sizeof (unsigned);
+
+// Field is within the part of the options the caller knows of
+
+#define HAS_OPTION(options, field) \
+	((options)->struct_size >= offsetof (sccs_options, field) + sizeof ((options)->field))
+
+
+// Pool shared by all calls asking for the default thread count,
+// NULL on single core machines
+
+static CThreadPool *
+getSharedPool ()
+{
+	static std::unique_ptr<CThreadPool> sPool (
+		(std::thread::hardware_concurrency () > 1) ?
+			new CThreadPool (std::thread::hardware_concurrency () - 1) : NULL);
+
+	return sPool.get ();
+}
+
+
+static sccs_status
+failure (sccs_status inStatus, const char *inMessage, const char *inInfo = NULL)
+{
+	sLastError = inMessage;
+
+	if (inInfo != NULL  &&  *inInfo != '\0')
+	{
+		sLastError.append (": ").append (inInfo);
+	}
+
+	return inStatus;
+}
+
+
+// Moves the string to a malloc'ed buffer, so that it can be freed from C
+
+static sccs_status
+release (const std::string &inData, sccs_buffer *outBuffer)
+{
+	outBuffer->data = (char *) malloc (std::max<size_t> (inData.size (), 1));
+
+	if (outBuffer->data == NULL)
+	{
+		return failure (SCCS_E_NO_MEMORY, "Not enough memory");
+	}
+
+	memcpy (outBuffer->data, inData.data (), inData.size ());
+	outBuffer->size = inData.size ();
+
+	sLastError.clear ();
+
+	return SCCS_OK;
+}
+
+
+// Runs the call, mapping library exceptions to status codes
+
+template <class F>
+static sccs_status
+guard (F inCall)
+{
+	try
+	{
+		return inCall ();
+	}
+	catch (const XFilesIdentical &ex)		{ return failure (SCCS_E_IDENTICAL, ex.what ()); }
+	catch (const XEmptySource &ex)			{ return failure (SCCS_E_EMPTY_SOURCE, ex.what ()); }
+	catch (const XBadDiff &ex)				{ return failure (SCCS_E_BAD_CHANGESET, ex.what (), ex.info ()); }
+	catch (const XCantDecode &ex)			{ return failure (SCCS_E_BAD_CHANGESET, ex.what (), ex.info ()); }
+	catch (const XContextNotFound &ex)		{ return failure (SCCS_E_CONTEXT_NOT_FOUND, ex.what (), ex.info ()); }
+	catch (const XAmbiguousContext &ex)		{ return failure (SCCS_E_AMBIGUOUS_CONTEXT, ex.what (), ex.info ()); }
+	catch (const XBadParameter &ex)			{ return failure (SCCS_E_INVALID_ARGUMENT, ex.what ()); }
+	catch (const XNotEnoughMemory &ex)		{ return failure (SCCS_E_NO_MEMORY, ex.what ()); }
+	catch (const XException &ex)			{ return failure (SCCS_E_INTERNAL, ex.what (), ex.info ()); }
+	catch (const std::bad_alloc &)			{ return failure (SCCS_E_NO_MEMORY, "Not enough memory"); }
+	catch (const std::exception &ex)		{ return failure (SCCS_E_INTERNAL, ex.what ()); }
+	catch (...)								{ return failure (SCCS_E_INTERNAL, "Unknown error"); }
+}
+
+
+extern "C" {
+
+int
+sccs_api_version (void)
+{
+	return SCCS_API_VERSION;
+}
+
+
+// Callers built against headers before version 4 get here. Their options
+// may be as small as those of version 1, so only those fields are set
+
+#undef sccs_options_init
+
+void
+sccs_options_init (sccs_options *out_options)
+{
+	sccs_options_init_ex (out_options, kOptionsSizeV1);
+}
+
+
+void
+sccs_options_init_ex (sccs_options *out_options, size_t options_size)
+{
+	if (out_options == NULL  ||  options_size < kOptionsSizeV1)
+	{
+		return;
+	}
+
+	// Fields of later versions are 0 by default, so are those of versions
+	// newer than the library and the padding of older ones
+
+	memset (out_options, 0, options_size);
+
+	out_options->struct_size = options_size;
+	out_options->max_memory = cmp::kDefaultMaxMemory;
+}
+
+
+sccs_status
+sccs_diff (
+	const char *source, size_t source_size,
+	const char *dest, size_t dest_size,
+	const sccs_options *options,
+	sccs_buffer *out_changeset)
+{
+	if (out_changeset == NULL  ||  (source == NULL  &&  source_size != 0)  ||  (dest == NULL  &&  dest_size != 0)  ||
+		(options != NULL  &&  options->struct_size < kOptionsSizeV1))
+	{
+		return failure (SCCS_E_INVALID_ARGUMENT, "Bad input parameter");
+	}
+
+	out_changeset->data = NULL;
+	out_changeset->size = 0;
+
+	return guard ([&] ()
+	{
+		CSccsOptions settings;
+		std::unique_ptr<CThreadPool> pool;
+
+		unsigned threads = 0;
+
+		if (options != NULL)
+		{
+			settings.mMaxMemory = (options->max_memory != 0) ? options->max_memory : cmp::kDefaultMaxMemory;
+			settings.mMaxCost = options->max_cost;
+			settings.mTimeout = options->timeout_ms;
+
+			threads = options->threads;
+
+			// Fields of later versions are only there if the caller knows them
+
+			if (HAS_OPTION (options, whitespace))
+			{
+				THROW_IF ((int) options->whitespace < SCCS_WHITESPACE_EXACT  ||
+					(int) options->whitespace > SCCS_WHITESPACE_CHANGE, XBadParameter);
+
+				settings.mNormalization = (CHashedString::ENormalization) options->whitespace;
+			}
+
+			if (HAS_OPTION (options, intraline))
+			{
+				THROW_IF ((int) options->intraline < SCCS_INTRALINE_NONE  ||
+					(int) options->intraline > SCCS_INTRALINE_CHAR, XBadParameter);
+
+				settings.mIntraline = (CIntraline::EMode) options->intraline;
+			}
+		}
+
+		if (threads == 0)
+		{
+			settings.mPool = getSharedPool ();
+		}
+		else if (threads > 1)
+		{
+			pool.reset (new CThreadPool (threads - 1));
+			settings.mPool = pool.get ();
+		}
+
+		std::string changeset;
+
+		CSccs::diff (source, source_size, dest, dest_size, &changeset, settings);
+
+		return release (changeset, out_changeset);
+	});
+}
+
+
+sccs_status
+sccs_apply (
+	const char *source, size_t source_size,
+	const char *changeset, size_t changeset_size,
+	sccs_buffer *out_result)
+{
+	if (out_result == NULL  ||  (source == NULL  &&  source_size != 0)  ||  (changeset == NULL  &&  changeset_size != 0))
+	{
+		return failure (SCCS_E_INVALID_ARGUMENT, "Bad input parameter");
+	}
+
+	out_result->data = NULL;
+	out_result->size = 0;
+
+	return guard ([&] ()
+	{
+		std::string result;
+
+		CSccs::apply (source, source_size, changeset, changeset_size, &result);
+
+		return release (result, out_result);
+	});
+}
+
+
+void
+sccs_buffer_free (sccs_buffer *buffer)
+{
+	if (buffer != NULL)
+	{
+		free (buffer->data);
+
+		buffer->data = NULL;
+		buffer->size = 0;
+	}
+}
+
+
+const char *
+sccs_last_error (void)
+{
+	return sLastError.c_str ();
+}
+
+}	// extern "C"
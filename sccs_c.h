@@ -0,0 +1,130 @@
+/*
+ *	sccs_c.h
+ *
+ *	Plain C interface of the sccs library. Only this header is a stable ABI,
+ *	structures carry their size so they can grow without breaking old callers
+ */
+
+#ifndef __sccs_c_h
+#define __sccs_c_h
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+	#if defined(SCCS_BUILD_SHARED)
+		#define SCCS_API __declspec(dllexport)
+	#elif defined(SCCS_USE_SHARED)
+		#define SCCS_API __declspec(dllimport)
+	#else
+		#define SCCS_API
+	#endif
+#else
+	#define SCCS_API __attribute__((visibility("default")))
+#endif
+
+#define SCCS_API_VERSION 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Status codes, anything but SCCS_OK leaves output buffers empty */
+
+typedef enum sccs_status
+{
+	SCCS_OK = 0,
+	SCCS_E_INVALID_ARGUMENT,
+	SCCS_E_IDENTICAL,				/* diff of equal inputs */
+	SCCS_E_EMPTY_SOURCE,			/* diff of an empty source */
+	SCCS_E_BAD_CHANGESET,
+	SCCS_E_CONTEXT_NOT_FOUND,		/* changeset does not fit the source */
+	SCCS_E_AMBIGUOUS_CONTEXT,
+	SCCS_E_NO_MEMORY,
+	SCCS_E_INTERNAL
+} sccs_status;
+
+/* Whitespace differences the comparison ignores, line ends are always ignored */
+
+typedef enum sccs_whitespace
+{
+	SCCS_WHITESPACE_EXACT = 0,
+	SCCS_WHITESPACE_TRAILING,		/* trailing whitespace */
+	SCCS_WHITESPACE_CHANGE			/* ...and the amount of whitespace elsewhere */
+} sccs_whitespace;
+
+/* Replaced lines written as edits of the lines they replace when shorter,
+   such changesets need API version 3 to apply */
+
+typedef enum sccs_intraline
+{
+	SCCS_INTRALINE_NONE = 0,
+	SCCS_INTRALINE_WORD,
+	SCCS_INTRALINE_CHAR
+} sccs_intraline;
+
+/* Comparison knobs, fill with sccs_options_init () before changing fields.
+   Fields are only ever appended and 0 is the default of every field added
+   after version 1, so the library reads what lies past the fields a caller
+   knows of, its padding included, as defaults */
+
+typedef struct sccs_options
+{
+	size_t struct_size;				/* size of the fields the caller knows of */
+	size_t max_memory;				/* working memory budget in bytes */
+	size_t max_cost;				/* give up the minimal diff past this many edits, 0 if unlimited */
+	unsigned timeout_ms;			/* ...or after this time, 0 if unlimited */
+	unsigned threads;				/* 0 shares a process-wide pool, 1 runs on the calling thread */
+	sccs_whitespace whitespace;		/* API version 2 */
+	sccs_intraline intraline;		/* API version 3 */
+} sccs_options;
+
+/* Output owned by the caller, release with sccs_buffer_free () */
+
+typedef struct sccs_buffer
+{
+	char *data;
+	size_t size;
+} sccs_buffer;
+
+SCCS_API int sccs_api_version (void);
+
+/* Fills the fields of API version 1 only, callers built against earlier
+   headers call it */
+
+SCCS_API void sccs_options_init (sccs_options *out_options);
+
+/* Fills options_size bytes, sizeof (sccs_options) of the header the caller
+   is built with. API version 4 */
+
+SCCS_API void sccs_options_init_ex (sccs_options *out_options, size_t options_size);
+
+/* Callers built against this header fill all the fields they know of */
+
+#define sccs_options_init(options) sccs_options_init_ex ((options), sizeof (*(options)))
+
+/* Changeset turning source into dest, options may be NULL */
+
+SCCS_API sccs_status sccs_diff (
+	const char *source, size_t source_size,
+	const char *dest, size_t dest_size,
+	const sccs_options *options,
+	sccs_buffer *out_changeset);
+
+/* Source patched with the changeset, which may be compressed */
+
+SCCS_API sccs_status sccs_apply (
+	const char *source, size_t source_size,
+	const char *changeset, size_t changeset_size,
+	sccs_buffer *out_result);
+
+SCCS_API void sccs_buffer_free (sccs_buffer *buffer);
+
+/* Message of the last failure on the calling thread, never NULL */
+
+SCCS_API const char *sccs_last_error (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __sccs_c_h */